@@ -0,0 +1,542 @@
+// Native benchmark of the Rclusterpp clustering engines, which doesn't require R. Each engine is run for every
+// combination of the number of observations (n), dimensions (d), data distribution and number of threads, with
+// one record of results per repetition, in CSV (the default) or JSON format. The phases of each clustering are
+// timed separately (in seconds):
+//
+//   setup      Initialize the clusters, along with any stored centers, data rows or spatial index
+//   distances  Compute the stored distance matrix (Lance-Williams engines only)
+//   cluster    Agglomerate the clusters
+//   populate   Translate the clusters to the hclust merge, height and order
+//
+// The sum of the merge heights is reported with each record to detect changes in the results. When built with 
+// RCLUSTERPP_STATS defined (make STATS=1), the statistics collected during each clustering (see 
+// Rclusterpp/stats.h) are reported too. Build with the Makefile in this directory, and run, e.g.,
+//
+//   ./hclust_benchmark --n 1000,10000 --d 10 --threads 1,2,4 --engines rnn,lw --format json > results.json
+//
+// Run with --help for all of the options.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <numeric>
+#include <stdexcept>
+
+#include <RclusterppNative.h>
+
+using namespace Rclusterpp;
+
+namespace {
+
+	enum EngineKinds {
+		RNN,         // cluster_via_rnn with cached neighbors
+		RNN_KDTREE,  // cluster_via_rnn with cached neighbors and a spatial index
+		CHAINS,      // cluster_via_rnn with many chains grown in parallel
+		HEAP,        // cluster_via_heap
+		SLINK,       // cluster_via_slink
+		MST          // cluster_via_mst
+	};
+
+	enum InputKinds {
+		CENTERS,     // Stored centers (Ward's, centroid and median linkages)
+		MOMENTS,     // Cluster moments (average squared Euclidean linkage)
+		ROWS,        // Pairwise distances between stored data rows
+		NORMALIZED,  // Pearson correlation distances between normalized data rows
+		CONDENSED    // Stored distance matrix with Lance-Williams updates
+	};
+
+	struct Case {
+		const char*  name;
+		EngineKinds  engine;
+		InputKinds   input;
+		LinkageKinds linkage;
+	};
+
+	// All other distances are Euclidean (squared for the Ward's, centroid and median linkages and the moments)
+	const Case cases[] = {
+		{ "rnn:ward",                RNN,        CENTERS,    WARD     },
+		{ "rnn-kdtree:ward",         RNN_KDTREE, CENTERS,    WARD     },
+		{ "rnn:average",             RNN,        ROWS,       AVERAGE  },
+		{ "rnn:average-sqeuclidean", RNN,        MOMENTS,    AVERAGE  },
+		{ "rnn:complete",            RNN,        ROWS,       COMPLETE },
+		{ "rnn:average-pearson",     RNN,        NORMALIZED, AVERAGE  },
+		{ "rnn:complete-pearson",    RNN,        NORMALIZED, COMPLETE },
+		{ "chains:ward",             CHAINS,     CENTERS,    WARD     },
+		{ "chains:average",          CHAINS,     ROWS,       AVERAGE  },
+		{ "chains:complete",         CHAINS,     ROWS,       COMPLETE },
+		{ "heap:centroid",           HEAP,       CENTERS,    CENTROID },
+		{ "heap:median",             HEAP,       CENTERS,    MEDIAN   },
+		{ "slink:single",            SLINK,      ROWS,       SINGLE   },
+		{ "mst:single",              MST,        ROWS,       SINGLE   },
+		{ "lw:average",              RNN,        CONDENSED,  AVERAGE  },
+		{ "lw:single",               RNN,        CONDENSED,  SINGLE   },
+		{ "lw:complete",             RNN,        CONDENSED,  COMPLETE },
+		{ "lw-chains:average",       CHAINS,     CONDENSED,  AVERAGE  },
+		{ "lw:centroid",             HEAP,       CONDENSED,  CENTROID },
+		{ "lw:median",               HEAP,       CONDENSED,  MEDIAN   }
+	};
+
+	struct Phases {
+		double setup, distances, cluster, populate;
+
+		Phases() : setup(0), distances(0), cluster(0), populate(0) {}
+
+		double total() const { return setup + distances + cluster + populate; }
+	};
+
+	// Wall clock time since the timer was created or last lapped
+	class Timer {
+		public:
+			typedef std::chrono::steady_clock clock_type;
+
+			Timer() : start_(clock_type::now()) {}
+
+			double lap() {
+				clock_type::time_point now = clock_type::now();
+				double elapsed = std::chrono::duration<double>(now - start_).count();
+				start_ = now;
+				return elapsed;
+			}
+
+		private:
+			clock_type::time_point start_;
+	};
+
+	typedef Eigen::RowMajorNumericMatrix rows_type;
+	typedef NumericCluster::plain        plain_type;
+	typedef NumericCluster::obs          obs_type;
+
+	template<class Cluster>
+	struct Clusters {
+		typedef ClusterVector<Cluster, ArenaClusterStorage<Cluster> > type;
+	};
+
+	// Reducible linkages with one of the nearest neighbor chain engines
+
+	template<class ClusteringMethod, class ClusterVector>
+	void cluster_via_chains(ClusteringMethod method, ClusterVector& clusters, EngineKinds engine, const ExecutionContext& context) {
+		if (engine == CHAINS)
+			cluster_via_rnn(method, clusters, ParallelChains, context);
+		else
+			cluster_via_rnn(method, clusters, CachedNeighbors, 8, context);
+	}
+
+	void cluster_from_centers(const Case& c, const Eigen::MatrixXd& data, NativeHclust& result, Phases& phases, const ExecutionContext& context) {
+		Timer timer;
+
+		Clusters<plain_type>::type clusters(data.rows());
+		init_clusters(data, clusters);
+		Methods::StoredCenters<double> centers(data);
+		phases.setup = timer.lap();
+
+		switch (c.linkage) {
+			default:
+				throw std::invalid_argument("Linkage not supported with stored centers");
+			case WARD:
+				if (c.engine == RNN_KDTREE) {
+					Methods::WardsKDTree<double> index(centers, clusters);
+					phases.setup += timer.lap();
+					cluster_via_rnn( wards_link<plain_type>(centers), clusters, CachedNeighbors, 8, index, context );
+				} else {
+					cluster_via_chains( wards_link<plain_type>(centers), clusters, c.engine, context );
+				}
+				break;
+			case CENTROID:
+				cluster_via_heap( centroid_link<plain_type>(centers), clusters, context );
+				break;
+			case MEDIAN:
+				cluster_via_heap( median_link<plain_type>(centers), clusters, context );
+				break;
+		}
+		phases.cluster = timer.lap();
+
+		populate_Rhclust(clusters, result);
+		phases.populate = timer.lap();
+	}
+
+	void cluster_from_moments(const Case& c, const Eigen::MatrixXd& data, NativeHclust& result, Phases& phases, const ExecutionContext& context) {
+		Timer timer;
+
+		Clusters<plain_type>::type clusters(data.rows());
+		init_clusters(data, clusters);
+		Methods::StoredMoments<double> moments(data);
+		phases.setup = timer.lap();
+
+		cluster_via_chains( average_sqeuclidean_link<plain_type>(moments), clusters, c.engine, context );
+		phases.cluster = timer.lap();
+
+		populate_Rhclust(clusters, result);
+		phases.populate = timer.lap();
+	}
+
+	void cluster_from_rows(const Case& c, const Eigen::MatrixXd& data, NativeHclust& result, Phases& phases, const ExecutionContext& context) {
+		Timer timer;
+
+		rows_type rows(data);
+		if (c.linkage == SINGLE) {
+			Clusters<plain_type>::type clusters(data.rows());
+			init_clusters(rows, clusters);
+			phases.setup = timer.lap();
+
+			if (c.engine == SLINK)
+				cluster_via_slink( stored_data_blocks<false>(rows), clusters, context );
+			else
+				cluster_via_mst( stored_data_blocks<false>(rows), clusters, context );
+			phases.cluster = timer.lap();
+
+			populate_Rhclust(clusters, result);
+		} else {
+			Clusters<obs_type>::type clusters(data.rows());
+			init_clusters_from_rows(rows, clusters);
+			phases.setup = timer.lap();
+
+			if (c.linkage == AVERAGE)
+				cluster_via_chains( average_link<obs_type>(stored_data_blocks<false>(rows)), clusters, c.engine, context );
+			else
+				cluster_via_chains( complete_link<obs_type>(stored_data_blocks<false>(rows)), clusters, c.engine, context );
+			phases.cluster = timer.lap();
+
+			populate_Rhclust(clusters, result);
+		}
+		phases.populate = timer.lap();
+	}
+
+	void cluster_from_normalized(const Case& c, const Eigen::MatrixXd& data, NativeHclust& result, Phases& phases, const ExecutionContext& context) {
+		Timer timer;
+
+		rows_type rows(data);
+		Methods::normalize_rows(rows, true);
+		Clusters<obs_type>::type clusters(data.rows());
+		init_clusters_from_rows(rows, clusters);
+		phases.setup = timer.lap();
+
+		if (c.linkage == AVERAGE)
+			cluster_via_chains( average_link<obs_type>(stored_normalized_blocks(rows)), clusters, c.engine, context );
+		else
+			cluster_via_chains( complete_link<obs_type>(stored_normalized_blocks(rows)), clusters, c.engine, context );
+		phases.cluster = timer.lap();
+
+		populate_Rhclust(clusters, result);
+		phases.populate = timer.lap();
+	}
+
+	void cluster_from_condensed(const Case& c, const Eigen::MatrixXd& data, NativeHclust& result, Phases& phases, const ExecutionContext& context) {
+		Timer timer;
+
+		rows_type rows(data);
+		CondensedNumericMatrix data_c(data.rows());
+		Clusters<plain_type>::type clusters(data.rows());
+		init_clusters(data_c, clusters);
+		phases.setup = timer.lap();
+
+		// The (non-reducible) centroid and median linkages use squared Euclidean distances
+		if (c.linkage == CENTROID || c.linkage == MEDIAN)
+			condensed_distances(stored_data_blocks<true>(rows), data_c, distance_tile_size(rows.cols(), sizeof(double)), context);
+		else
+			condensed_distances(stored_data_blocks<false>(rows), data_c, distance_tile_size(rows.cols(), sizeof(double)), context);
+		phases.distances = timer.lap();
+
+		switch (c.linkage) {
+			default:
+				throw std::invalid_argument("Linkage not supported with stored distances");
+			case AVERAGE:
+				cluster_via_chains( average_link<plain_type>(data_c, FromDistance), clusters, c.engine, context );
+				break;
+			case SINGLE:
+				cluster_via_chains( single_link<plain_type>(data_c, FromDistance), clusters, c.engine, context );
+				break;
+			case COMPLETE:
+				cluster_via_chains( complete_link<plain_type>(data_c, FromDistance), clusters, c.engine, context );
+				break;
+			case CENTROID:
+				cluster_via_heap( centroid_link<plain_type>(data_c, FromDistance), clusters, context );
+				break;
+			case MEDIAN:
+				cluster_via_heap( median_link<plain_type>(data_c, FromDistance), clusters, context );
+				break;
+		}
+		phases.cluster = timer.lap();
+
+		populate_Rhclust(clusters, result);
+		phases.populate = timer.lap();
+	}
+
+	void run_case(const Case& c, const Eigen::MatrixXd& data, NativeHclust& result, Phases& phases, const ExecutionContext& context) {
+		switch (c.input) {
+			case CENTERS:
+				cluster_from_centers(c, data, result, phases, context);
+				break;
+			case MOMENTS:
+				cluster_from_moments(c, data, result, phases, context);
+				break;
+			case ROWS:
+				cluster_from_rows(c, data, result, phases, context);
+				break;
+			case NORMALIZED:
+				cluster_from_normalized(c, data, result, phases, context);
+				break;
+			case CONDENSED:
+				cluster_from_condensed(c, data, result, phases, context);
+				break;
+		}
+	}
+
+	// Data sets. Observations are stored as the rows of a column-major matrix, as they are in R.
+
+	Eigen::MatrixXd make_data(const std::string& distribution, size_t n, size_t d, unsigned long seed) {
+		std::mt19937_64 rng(seed);
+		Eigen::MatrixXd data(n, d);
+
+		if (distribution == "uniform") {
+			std::uniform_real_distribution<double> u(0., 1.);
+			for (ssize_t j=0; j<data.cols(); j++)
+				for (ssize_t i=0; i<data.rows(); i++)
+					data(i, j) = u(rng);
+		} else if (distribution == "gaussian") {
+			std::normal_distribution<double> g(0., 1.);
+			for (ssize_t j=0; j<data.cols(); j++)
+				for (ssize_t i=0; i<data.rows(); i++)
+					data(i, j) = g(rng);
+		} else if (distribution == "blobs") {
+			// Tight clusters of observations around 16 uniformly distributed centers
+			const size_t k = 16;
+			std::uniform_real_distribution<double> u(0., 1.);
+			std::normal_distribution<double>       g(0., 0.02);
+			std::uniform_int_distribution<size_t>  b(0, k-1);
+			Eigen::MatrixXd centers(k, d);
+			for (ssize_t j=0; j<centers.cols(); j++)
+				for (ssize_t i=0; i<centers.rows(); i++)
+					centers(i, j) = u(rng);
+			for (ssize_t i=0; i<data.rows(); i++) {
+				size_t c = b(rng);
+				for (ssize_t j=0; j<data.cols(); j++)
+					data(i, j) = centers(c, j) + g(rng);
+			}
+		} else if (distribution == "grid") {
+			// Small integer coordinates, with many tied distances
+			std::uniform_int_distribution<int> u(0, 7);
+			for (ssize_t j=0; j<data.cols(); j++)
+				for (ssize_t i=0; i<data.rows(); i++)
+					data(i, j) = u(rng);
+		} else {
+			throw std::invalid_argument("Unknown distribution: " + distribution);
+		}
+		return data;
+	}
+
+	// Command line parsing
+
+	std::vector<std::string> split(const std::string& list) {
+		std::vector<std::string> items;
+		size_t start = 0;
+		while (start <= list.size()) {
+			size_t end = list.find(',', start);
+			if (end == std::string::npos)
+				end = list.size();
+			if (end > start)
+				items.push_back(list.substr(start, end - start));
+			start = end + 1;
+		}
+		return items;
+	}
+
+	std::vector<size_t> split_sizes(const std::string& list) {
+		std::vector<std::string> items = split(list);
+		std::vector<size_t>      sizes;
+		for (size_t i=0; i<items.size(); i++) {
+			char* end;
+			long  value = std::strtol(items[i].c_str(), &end, 10);
+			if (*end != '\0' || value <= 0)
+				throw std::invalid_argument("Invalid size: " + items[i]);
+			sizes.push_back(value);
+		}
+		return sizes;
+	}
+
+	// Engines are selected by the full case name (e.g. "rnn:ward"), the engine prefix (e.g. "rnn") or the
+	// linkage suffix (e.g. "ward")
+	bool selected(const Case& c, const std::vector<std::string>& engines) {
+		std::string name(c.name), prefix(name.substr(0, name.find(':'))), suffix(name.substr(name.find(':') + 1));
+		for (size_t i=0; i<engines.size(); i++) {
+			if (engines[i] == "all" || engines[i] == name || engines[i] == prefix || engines[i] == suffix)
+				return true;
+		}
+		return false;
+	}
+
+	void usage(FILE* out) {
+		std::fprintf(out,
+			"Usage: hclust_benchmark [options]\n"
+			"  --n LIST              Numbers of observations (default 1000,4000)\n"
+			"  --d LIST              Numbers of dimensions (default 2,16)\n"
+			"  --threads LIST        Numbers of threads (default 1 and the OpenMP maximum)\n"
+			"  --distributions LIST  Data distributions among uniform,gaussian,blobs,grid (default uniform,blobs)\n"
+			"  --engines LIST        Engines, by name, engine or linkage, or all (default all)\n"
+			"  --reps N              Repetitions of each clustering (default 3)\n"
+			"  --max-condensed N     Largest n for engines with stored distances (default 20000)\n"
+			"  --seed N              Random seed for the data (default 42)\n"
+			"  --format csv|json     Output format (default csv)\n"
+			"  --list                List the engines and exit\n"
+		);
+		std::fprintf(out, "Engines:");
+		for (size_t i=0; i<sizeof(cases)/sizeof(cases[0]); i++)
+			std::fprintf(out, " %s", cases[i].name);
+		std::fprintf(out, "\n");
+	}
+
+	struct Record {
+		const char* engine;
+		std::string distribution;
+		size_t      n, d;
+		int         threads, rep;
+		Phases      phases;
+		double      height_sum;
+		std::vector<double> stats;
+	};
+
+	void write_header(FILE* out, bool json) {
+		if (json) {
+			std::fprintf(out, "[");
+		} else {
+			std::fprintf(out, "engine,distribution,n,d,threads,rep,setup,distances,cluster,populate,total,height_sum");
+#ifdef RCLUSTERPP_STATS
+			for (int c=0; c<Stats::NUM_COUNTERS; c++)
+				std::fprintf(out, ",%s", Stats::name(c));
+#endif
+			std::fprintf(out, "\n");
+		}
+	}
+
+	void write_record(FILE* out, const Record& r, bool json, bool first) {
+		if (json) {
+			std::fprintf(out,
+				"%s\n  {\"engine\": \"%s\", \"distribution\": \"%s\", \"n\": %zu, \"d\": %zu, \"threads\": %d, \"rep\": %d, "
+				"\"setup\": %.6f, \"distances\": %.6f, \"cluster\": %.6f, \"populate\": %.6f, \"total\": %.6f, \"height_sum\": %.17g",
+				first ? "" : ",", r.engine, r.distribution.c_str(), r.n, r.d, r.threads, r.rep,
+				r.phases.setup, r.phases.distances, r.phases.cluster, r.phases.populate, r.phases.total(), r.height_sum
+			);
+#ifdef RCLUSTERPP_STATS
+			std::fprintf(out, ", \"stats\": {");
+			for (size_t c=0; c<r.stats.size(); c++)
+				std::fprintf(out, "%s\"%s\": %.17g", (c == 0) ? "" : ", ", Stats::name(c), r.stats[c]);
+			std::fprintf(out, "}");
+#endif
+			std::fprintf(out, "}");
+		} else {
+			std::fprintf(out, "%s,%s,%zu,%zu,%d,%d,%.6f,%.6f,%.6f,%.6f,%.6f,%.17g",
+				r.engine, r.distribution.c_str(), r.n, r.d, r.threads, r.rep,
+				r.phases.setup, r.phases.distances, r.phases.cluster, r.phases.populate, r.phases.total(), r.height_sum
+			);
+			for (size_t c=0; c<r.stats.size(); c++)
+				std::fprintf(out, ",%.17g", r.stats[c]);
+			std::fprintf(out, "\n");
+		}
+		std::fflush(out);
+	}
+
+} // end of anonymous namespace
+
+int main(int argc, char* argv[]) {
+	std::vector<size_t>      ns(split_sizes("1000,4000")), ds(split_sizes("2,16"));
+	std::vector<size_t>      threads;
+	std::vector<std::string> dists(split("uniform,blobs")), engines(split("all"));
+	size_t                   reps = 3, max_condensed = 20000;
+	unsigned long            seed = 42;
+	bool                     json = false;
+
+	threads.push_back(1);
+	if (Util::max_threads() > 1)
+		threads.push_back(Util::max_threads());
+
+	try {
+		for (int i=1; i<argc; i++) {
+			std::string arg(argv[i]);
+			if (arg == "--help") {
+				usage(stdout);
+				return 0;
+			} else if (arg == "--list") {
+				for (size_t c=0; c<sizeof(cases)/sizeof(cases[0]); c++)
+					std::printf("%s\n", cases[c].name);
+				return 0;
+			} else if (i + 1 >= argc) {
+				throw std::invalid_argument("Missing or unknown option: " + arg);
+			}
+
+			std::string value(argv[++i]);
+			if (arg == "--n")
+				ns = split_sizes(value);
+			else if (arg == "--d")
+				ds = split_sizes(value);
+			else if (arg == "--threads")
+				threads = split_sizes(value);
+			else if (arg == "--distributions")
+				dists = split(value);
+			else if (arg == "--engines")
+				engines = split(value);
+			else if (arg == "--reps")
+				reps = split_sizes(value).at(0);
+			else if (arg == "--max-condensed")
+				max_condensed = split_sizes(value).at(0);
+			else if (arg == "--seed")
+				seed = split_sizes(value).at(0);
+			else if (arg == "--format" && (value == "csv" || value == "json"))
+				json = (value == "json");
+			else
+				throw std::invalid_argument("Unknown option: " + arg + " " + value);
+		}
+	} catch (std::exception& e) {
+		std::fprintf(stderr, "%s\n", e.what());
+		usage(stderr);
+		return 1;
+	}
+
+	write_header(stdout, json);
+
+	bool first = true;
+	try {
+		for (size_t di=0; di<dists.size(); di++) {
+			for (size_t ni=0; ni<ns.size(); ni++) {
+				for (size_t dd=0; dd<ds.size(); dd++) {
+					if (ns[ni] < 2)
+						continue;
+					Eigen::MatrixXd data = make_data(dists[di], ns[ni], ds[dd], seed);
+
+					for (size_t ci=0; ci<sizeof(cases)/sizeof(cases[0]); ci++) {
+						const Case& c = cases[ci];
+						if (!selected(c, engines) || (c.input == CONDENSED && ns[ni] > max_condensed))
+							continue;
+
+						for (size_t ti=0; ti<threads.size(); ti++) {
+							ExecutionContext context(threads[ti]);
+							for (size_t rep=0; rep<reps; rep++) {
+								NativeHclust result(ns[ni]);
+								Record       record = { c.name, dists[di], ns[ni], ds[dd], context.threads(), (int)rep, Phases(), 0., std::vector<double>() };
+
+								RCLUSTERPP_STATS_RESET();
+								run_case(c, data, result, record.phases, context);
+								record.height_sum = std::accumulate(result.height.begin(), result.height.end(), 0.);
+#ifdef RCLUSTERPP_STATS
+								record.stats = Stats::collect();
+#endif
+
+								write_record(stdout, record, json, first);
+								first = false;
+							}
+						}
+					}
+				}
+			}
+		}
+	} catch (std::exception& e) {
+		std::fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+
+	if (json)
+		std::printf("\n]\n");
+	return 0;
+}
@@ -16,8 +16,12 @@
 #include <RclusterppEigenSugar.h>
 
 #include <Rclusterpp/cluster.h>
+#include <Rclusterpp/condensed.h>
 #include <Rclusterpp/algorithm.h>
 #include <Rclusterpp/method.h>
+#include <Rclusterpp/kdtree.h>
+#include <Rclusterpp/aggregate.h>
+#include <Rclusterpp/batch.h>
 #include <Rclusterpp/hclust.h>
 
 #endif
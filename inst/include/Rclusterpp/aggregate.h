@@ -0,0 +1,179 @@
+#ifndef RCLUSTERPP_AGGREGATE_H
+#define RCLUSTERPP_AGGREGATE_H
+
+#include <limits>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <unordered_set>
+
+namespace Rclusterpp {
+
+	// Weighted micro-clusters summarizing a (large) set of observations, suitable as the initial clusters for
+	// hierarchical clustering (with the weights as the members). Each observation is assigned to exactly one
+	// micro-cluster, so observations can be mapped back to the leaves of the resulting dendrogram.
+	template<class Value>
+	struct MicroClusters {
+		typedef Value                                                                  value_type;
+		typedef Eigen::Matrix<Value, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> centers_type;
+
+		centers_type        centers;     // One row per micro-cluster
+		std::vector<double> weights;     // Number of observations in each micro-cluster
+		std::vector<size_t> assignment;  // Micro-cluster of each observation
+	};
+
+	namespace Util {
+
+		// Nearest center (by distance) to row r, ties broken by the lesser index
+		template<class Matrix, class Distance>
+		size_t nearest_center(const Matrix& rows, size_t r, const Matrix& centers, Distance distance) {
+			typedef typename Distance::result_type distance_type;
+
+			size_t        min_c = 0;
+			distance_type min_d = std::numeric_limits<distance_type>::max();
+			for (ssize_t c=0; c<centers.rows(); c++) {
+				distance_type d = distance(rows.row(r), centers.row(c));
+				if (d < min_d) {
+					min_d = d;
+					min_c = c;
+				}
+			}
+			return min_c;
+		}
+
+	} // end of Util namespace
+
+	// Reduce the n observations (rows) in data to at most k weighted micro-clusters with mini-batch k-means
+	// (Sculley 2010). Centers are initialized with k distinct random observations and then refined with the
+	// given number of mini-batches of randomly sampled observations. A final (parallel) pass assigns every
+	// observation to its nearest center, and the micro-clusters are the means of the assigned observations.
+	// Empty micro-clusters are dropped. Memory is O(k*m) beyond the data (and assignment), and the data are
+	// only ever read in tiles of rows, so the data can be a (column-major) view of R's memory. Observations
+	// are assigned by the given distance, but the centers are always means. The result depends only on the
+	// seed (up to the order of the floating point reductions in the final pass).
+	template<class Matrix, class Distance, class Value>
+	void aggregate_via_kmeans(
+		const Matrix& data, Distance distance, size_t k, size_t batch, size_t iterations, unsigned int seed, MicroClusters<Value>& result,
+		const ExecutionContext& context=ExecutionContext()
+	) {
+		typedef typename MicroClusters<Value>::centers_type                                    centers_type;
+		typedef Eigen::Matrix<Value, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>          rows_type;
+
+		const ssize_t n = data.rows(), m = data.cols(), tile = 256;
+
+		k = std::min<size_t>(k, n);
+
+		std::mt19937 rng(seed);
+		std::uniform_int_distribution<ssize_t> sample(0, std::max<ssize_t>(n - 1, 0));
+
+		// Initial centers are distinct observations (Floyd's algorithm), in increasing order
+		std::vector<ssize_t> initial;
+		{
+			std::unordered_set<ssize_t> chosen;
+			for (ssize_t j=n-k; j<n; j++) {
+				ssize_t t = std::uniform_int_distribution<ssize_t>(0, j)(rng);
+				if (!chosen.insert(t).second)
+					chosen.insert(t = j);
+				initial.push_back(t);
+			}
+			std::sort(initial.begin(), initial.end());
+		}
+
+		centers_type centers(k, m);
+		for (size_t c=0; c<k; c++) {
+			centers.row(c) = data.row(initial[c]).template cast<Value>();
+		}
+
+		// Mini-batches: assign the sampled observations in parallel, then update the centers in sample order
+		// with per-center learning rates
+		if (k < (size_t)n) {
+			std::vector<double>  counts(k, 0.);
+			std::vector<ssize_t> samples(batch);
+			std::vector<size_t>  nearest(batch);
+			rows_type            rows(batch, m);
+			for (size_t it=0; it<iterations; it++) {
+				for (size_t b=0; b<batch; b++) {
+					samples[b] = sample(rng);
+					rows.row(b) = data.row(samples[b]).template cast<Value>();
+				}
+
+#ifdef _OPENMP
+				#pragma omp parallel for num_threads(context.threads()) schedule(static)
+#endif
+				for (ssize_t b=0; b<(ssize_t)batch; b++) {
+					nearest[b] = Util::nearest_center(rows, b, centers, distance);
+				}
+
+				for (size_t b=0; b<batch; b++) {
+					size_t c   = nearest[b];
+					Value  eta = 1. / ++counts[c];
+					centers.row(c) = (1 - eta) * centers.row(c) + eta * rows.row(b);
+				}
+			}
+		}
+
+		// Final assignment, accumulating the sums of the assigned observations in per-thread slots
+		result.assignment.resize(n);
+
+		Util::TeamSlots<std::pair<Eigen::MatrixXd, std::vector<double> > > slots(context.threads());
+
+#ifdef _OPENMP
+		#pragma omp parallel num_threads(context.threads())
+#endif
+		{
+			Eigen::MatrixXd&     sums   = slots.local().first;
+			std::vector<double>& counts = slots.local().second;
+			sums.setZero(k, m);
+			counts.assign(k, 0.);
+
+			rows_type rows(tile, m);
+#ifdef _OPENMP
+			#pragma omp for schedule(dynamic)
+#endif
+			for (ssize_t r=0; r<n; r+=tile) {
+				ssize_t nr = std::min(tile, n - r);
+				rows.topRows(nr) = data.middleRows(r, nr).template cast<Value>();
+				for (ssize_t i=0; i<nr; i++) {
+					size_t c = Util::nearest_center(rows, i, centers, distance);
+					result.assignment[r + i] = c;
+					sums.row(c) += rows.row(i).template cast<double>();
+					counts[c]++;
+				}
+			}
+		}
+
+		Eigen::MatrixXd     sums   = Eigen::MatrixXd::Zero(k, m);
+		std::vector<double> counts(k, 0.);
+		for (int t=0, te=context.threads(); t<te; t++) {
+			if (slots[t].second.size() != k)
+				continue;  // Thread did not participate
+			sums += slots[t].first;
+			for (size_t c=0; c<k; c++)
+				counts[c] += slots[t].second[c];
+		}
+
+		// Micro-clusters are the non-empty clusters, in order of their centers
+		std::vector<size_t> index(k);
+		size_t              nm = 0;
+		for (size_t c=0; c<k; c++) {
+			index[c] = nm;
+			if (counts[c] > 0)
+				nm++;
+		}
+
+		result.centers.resize(nm, m);
+		result.weights.resize(nm);
+		for (size_t c=0; c<k; c++) {
+			if (counts[c] > 0) {
+				result.centers.row(index[c]) = (sums.row(c) / counts[c]).template cast<Value>();
+				result.weights[index[c]]     = counts[c];
+			}
+		}
+		for (ssize_t i=0; i<n; i++) {
+			result.assignment[i] = index[result.assignment[i]];
+		}
+	}
+
+} // end of Rclusterpp namespace
+
+#endif
@@ -6,59 +6,207 @@
 #include <algorithm>
 #include <functional>
 #include <stack>
+#include <type_traits>
 
 #include <Rclusterpp/cluster.h>
 #include <Rclusterpp/util.h>
+#include <Rclusterpp/stats.h>
 
 namespace Rclusterpp {
 
+	// Nearest neighbor scans are implemented as "orphaned" work-sharing constructs that must be called by all
+	// threads in an enclosing team (or outside of any parallel region), so that the clustering engines can
+	// maintain a single thread team for the entire clustering. Partial results are reduced through per-thread
+	// slots with ties broken by position, so the results are independent of the number of threads.
+
+	template<class Distance>
+	struct NeighborSlots {
+		typedef std::pair<Distance, ssize_t> entry_type;  // Distance and offset of neighbor
+		
+		Util::TeamSlots<std::vector<entry_type> > slots;
+		Distance bound;
+
+		explicit NeighborSlots(const ExecutionContext& context) : slots(context.threads()) {}
+	};
+
+	template<class RandomIterator, class Distancer>
+	std::pair<RandomIterator, typename Distancer::result_type> team_nearest_neighbor(
+		const RandomIterator& first, 
+		const RandomIterator& last, 
+		Distancer       distancer, 
+		typename Distancer::result_type max_dist,
+		NeighborSlots<typename Distancer::result_type>& neighbors
+	) {
+		
+		typedef typename Distancer::result_type Dist_t;
+		typedef std::pair<Dist_t, ssize_t>      Entry_t;
+
+		RCLUSTERPP_STATS_TEAM_TIME(NEIGHBOR_TIME);
+		RCLUSTERPP_STATS_TEAM_ADD(DISTANCES, last - first);
+
+		ssize_t n = last - first;
+		Entry_t min_l(max_dist, n);
+
+#ifdef _OPENMP
+		#pragma omp for schedule(static) nowait	
+#endif
+		for (ssize_t i=0; i<n; i++) {
+			Dist_t dist = distancer(*(first+i), min_l.first);				
+			if (dist < min_l.first) {
+				min_l = Entry_t(dist, i);
+			}
+		}
+
+		neighbors.slots.local().assign(1, min_l);
+		
+#ifdef _OPENMP
+		#pragma omp barrier
+#endif
+
+		// All threads perform the (inexpensive) reduction so no further synchronization is required
+		Entry_t min(max_dist, n);
+		for (int t=0, te=Util::team_size(); t<te; t++) {
+			min = std::min(min, neighbors.slots[t].front());
+		}
+		return std::make_pair(first + min.second, min.first);	
+	}
+
 	template<class RandomIterator, class Distancer>
 	std::pair<RandomIterator, typename Distancer::result_type> nearest_neighbor(
 		const RandomIterator& first, 
 		const RandomIterator& last, 
 		Distancer       distancer, 
-		typename Distancer::result_type max_dist=std::numeric_limits<typename Distancer::result_type>::max()
+		typename Distancer::result_type max_dist=std::numeric_limits<typename Distancer::result_type>::max(),
+		const ExecutionContext& context=ExecutionContext()
 	) {
 	
 		typedef typename Distancer::result_type Dist_t;
 
-		RandomIterator min_i = last;
-		Dist_t         min_d = max_dist;
+		NeighborSlots<Dist_t> slots(context);
+		std::pair<RandomIterator, Dist_t> min;
 
 #ifdef _OPENMP
-		#pragma omp parallel shared(min_i, min_d, distancer)	
+		#pragma omp parallel num_threads(context.threads()) shared(min, slots, distancer)	
 #endif
 		{
-			RandomIterator min_i_l;
-			Dist_t         min_d_l = min_d;
+			std::pair<RandomIterator, Dist_t> min_l = team_nearest_neighbor(first, last, distancer, max_dist, slots);
+#ifdef _OPENMP
+			#pragma omp master
+#endif
+			min = min_l;
+		}
+		return min;	
+	}
+
+	template<class RandomIterator, class Distancer, class Neighbors>
+	void team_nearest_neighbors(
+		const RandomIterator& first, 
+		const RandomIterator& last, 
+		Distancer       distancer, 
+		size_t          k,
+		Neighbors&      neighbors,
+		NeighborSlots<typename Distancer::result_type>& slots
+	) {
+		// Find the k nearest neighbors, sorted by increasing distance with ties broken by position, and
+		// a bound on the distance to all other neighbors (stored in slots)
+		
+		typedef typename Distancer::result_type Dist_t;
+		typedef std::pair<Dist_t, ssize_t>      Entry_t;
+		
+		RCLUSTERPP_STATS_TEAM_TIME(NEIGHBOR_TIME);
+		RCLUSTERPP_STATS_TEAM_ADD(DISTANCES, last - first);
+		
+		ssize_t n = last - first;
+		
+		std::vector<Entry_t>& nearest_l = slots.slots.local();
+		nearest_l.clear();
+		nearest_l.reserve(k + 1);
 
 #ifdef _OPENMP
-			#pragma omp for nowait	
+		#pragma omp for schedule(static) nowait	
 #endif
-			for (ssize_t i=0; i<(last-first); i++) {
-				Dist_t dist = distancer(*(first+i), min_d_l);				
-				if (dist < min_d_l) {
-					min_i_l = first + i; 
-					min_d_l = dist;
-				}
+		for (ssize_t i=0; i<n; i++) {
+			Dist_t max_d = (nearest_l.size() < k) ? std::numeric_limits<Dist_t>::max() : nearest_l.back().first;
+			Dist_t dist  = distancer(*(first+i), max_d);
+			if (nearest_l.size() < k || dist < max_d) {
+				nearest_l.insert(std::upper_bound(nearest_l.begin(), nearest_l.end(), Entry_t(dist, i)), Entry_t(dist, i));
+				if (nearest_l.size() > k)
+					nearest_l.pop_back();
 			}
+		}
 
 #ifdef _OPENMP
-			#pragma omp critical	
+		#pragma omp barrier
+		#pragma omp single
 #endif
-			{
-				if (min_d_l < min_d) {
-					min_i = min_i_l; 
-					min_d = min_d_l; 
-				}
+		{
+			std::vector<Entry_t> nearest, merged;
+			for (int t=0, te=Util::team_size(); t<te; t++) {
+				merged.resize(nearest.size() + slots.slots[t].size());
+				std::merge(nearest.begin(), nearest.end(), slots.slots[t].begin(), slots.slots[t].end(), merged.begin());
+				if (merged.size() > k)
+					merged.resize(k);
+				nearest.swap(merged);
 			}
+
+			neighbors.clear();
+			for (size_t i=0; i<nearest.size(); i++)
+				neighbors.push_back( std::make_pair(*(first + nearest[i].second), nearest[i].first) );
+			
+			slots.bound = ((ssize_t)k < n) ? nearest.back().first : std::numeric_limits<Dist_t>::max();
 		}
-		return std::make_pair(min_i, min_d);	
 	}
+	
+	template<class RandomIterator, class Distancer, class Neighbors>
+	typename Distancer::result_type nearest_neighbors(
+		const RandomIterator& first, 
+		const RandomIterator& last, 
+		Distancer       distancer, 
+		size_t          k,
+		Neighbors&      neighbors,
+		const ExecutionContext& context=ExecutionContext()
+	) {
+		// Find the k nearest neighbors, sorted by increasing distance with ties broken by position, and
+		// return a bound on the distance to all other neighbors
+		
+		NeighborSlots<typename Distancer::result_type> slots(context);
 
+#ifdef _OPENMP
+		#pragma omp parallel num_threads(context.threads()) shared(slots, neighbors, distancer)	
+#endif
+		team_nearest_neighbors(first, last, distancer, k, neighbors, slots);
+		
+		return slots.bound;
+	}
+
+	template<class ClusterVector>
+	void sort_agglomerations(ClusterVector& clusters) {
+		
+		typedef ClusterVector                        clusters_type;
+		typedef typename clusters_type::cluster_type cluster_type;
+
+		size_t initial_clusters = clusters.initial_clusters(), result_clusters = clusters.size();
+
+		// Re-order the clusters, with initial clusters in the beginning, ordered by id
+		// from -1 .. -initial_clusters, followed by the agglomerated clusters sorted by
+		// increasing disimilarity. Stable partition and stable sorting is required for
+    // the latter to ensure merge order is maintaining for clusters with identical
+    // dissimilarity.
+		
+    // Note, sort requires strict weak ordering and will fail in a data dependent way
+    // if the comparison function does not satisfy that requirement
+    
+		typename clusters_type::iterator part = std::stable_partition(clusters.begin(), clusters.end(), std::mem_fn(&cluster_type::initial));
+    std::sort(clusters.begin(), part, &compare_id<cluster_type>); 
+		std::stable_sort(part, clusters.end(), &compare_disimilarity<cluster_type>); 
+
+		for (size_t i=initial_clusters; i<result_clusters; i++) {
+			clusters[i]->set_id(i - initial_clusters + 1);  // Use R hclust 1-indexed convention for Id's
+		}
+	}
 
 	template<class ClusteringMethod, class ClusterVector>
-	void cluster_via_rnn(ClusteringMethod method, ClusterVector& clusters) {
+	void cluster_via_rnn(ClusteringMethod method, ClusterVector& clusters, const ExecutionContext& context=ExecutionContext()) {
 
 		typedef ClusterVector                            clusters_type;
 		typedef typename clusters_type::cluster_type     cluster_type;
@@ -82,68 +230,418 @@ namespace Rclusterpp {
 		size_t initial_clusters = clusters.size(), result_clusters = (initial_clusters * 2) - 1;
 		clusters.reserve(result_clusters);
 		
-		// List of valid clusters (used in mer
+		// List of valid clusters (used in merging)
 		Util::IndexList valid(initial_clusters);
 
 		typename clusters_type::iterator next_unchained = clusters.begin();
-		while (clusters.size() != result_clusters) {
-			if (chain.empty()) {
-				// Pick next "unchained" cluster as default
-				chain.push( entry_type(*next_unchained, std::numeric_limits<distance_type>::max()) );
-				++next_unchained;
-			} else {
-
-				// Find next nearest neighbor from remaining "unchained" clusters			
-				nearn_type nn = nearest_neighbor(
+
+		// A single thread team is maintained for the entire clustering. The chain is manipulated by one thread,
+		// while all threads participate in the nearest neighbor scans (and team merges). 
+		bool          scan   = false;  // Is a nearest neighbor scan needed for the tip of the chain?
+		cluster_type* merged = NULL;   // Newly merged cluster awaiting a team merge
+		NeighborSlots<distance_type> slots(context);
+
+#ifdef _OPENMP
+		#pragma omp parallel num_threads(context.threads()) shared(scan, merged, slots, chain, clusters, next_unchained, valid, method)
+#endif
+		{
+			nearn_type nn;  // All threads obtain the same result from the scan 
+			while (true) {
+#ifdef _OPENMP
+				#pragma omp single
+#endif
+				while (true) {
+					merged = NULL;
+					if (scan) {
+						scan = false;
+						if (nn.first != clusters.end()) {
+							std::iter_swap(next_unchained, nn_cluster(nn));
+							chain.push( entry_type(*next_unchained, distance_to_nn(nn)) );
+							++next_unchained;
+							RCLUSTERPP_STATS_ADD(CHAIN_PUSHES, 1);
+							RCLUSTERPP_STATS_MAX(MAX_CHAIN, chain.size());
+						} else {
+							RCLUSTERPP_STATS_TIME(MERGE_TIME);
+							RCLUSTERPP_STATS_ADD(CHAIN_POPS, 2);
+
+							// Tip of chain is recursive nearest neighbor
+							cluster_type* r = cluster_at_tip(chain);
+							distance_type d = distance_to_tip(chain);
+							chain.pop();
+
+							cluster_type* l  = cluster_at_tip(chain);
+							chain.pop();
+
+							// Remove "tip" and "next tip"  from chain and merge into new cluster appended to "unchained" clusters
+							cluster_type* cn = clusters.make_cluster(std::min(l->idx(), r->idx()), l, r, d);
+						
+							valid.remove(std::max(r->idx(), l->idx()));
+							if (ClusteringMethod::merger_type::team_merge)
+								merged = cn;
+							else
+								method.merger(*cn, *(cn->parent1()), *(cn->parent2()), valid);
+						
+							clusters.push_back(cn);
+							if (merged)
+								break;
+						}
+					}
+				
+					if (clusters.size() == result_clusters)
+						break;
+				
+					if (chain.empty()) {
+						// Pick next "unchained" cluster as default
+						chain.push( entry_type(*next_unchained, std::numeric_limits<distance_type>::max()) );
+						++next_unchained;
+						RCLUSTERPP_STATS_ADD(CHAIN_PUSHES, 1);
+						RCLUSTERPP_STATS_MAX(MAX_CHAIN, chain.size());
+					} else {
+						// Find next nearest neighbor from remaining "unchained" clusters
+						scan = true;
+						break;
+					}
+				}
+
+				if (merged) {
+					RCLUSTERPP_STATS_TEAM_TIME(MERGE_TIME);
+					method.merger(*merged, *(merged->parent1()), *(merged->parent2()), valid);
+					continue;
+				}
+			
+				if (!scan)
+					break;
+
+				nn = team_nearest_neighbor(
 					next_unchained, 
 					clusters.end(), 
 					Util::cluster_bind(method.distancer, cluster_at_tip(chain)), // Bind tip into distance function for computing nearest neighbor 
-					distance_to_tip(chain)
+					distance_to_tip(chain),
+					slots
 				);
-				
-				if (nn.first != clusters.end()) {
-					std::iter_swap(next_unchained, nn_cluster(nn));
-					chain.push( entry_type(*next_unchained, distance_to_nn(nn)) );
-					++next_unchained;
+			}
+		}
+	
+		sort_agglomerations(clusters);
+	}
+
+	// Neighbor search for the cached RNN engine that scans all active clusters. Searches are invoked by every
+	// thread in the team and must find the k nearest active clusters to the tip (excluding the tip, which is 
+	// at the back of the active clusters), sorted by increasing distance, along with a bound on the distance 
+	// to all other active clusters (stored in slots). Searches are notified of each merge after the merger
+	// has been applied.
+	struct ScanNeighbors {
+		template<class Active, class Cluster, class Distancer, class Neighbors, class Slots>
+		void team_search(Active& active, Cluster* tip, Distancer& distancer, size_t k, Neighbors& neighbors, Slots& slots) {
+			team_nearest_neighbors(active.begin(), active.end() - 1, Util::cluster_bind(distancer, tip), k, neighbors, slots);
+		}
+		
+		template<class Cluster>
+		void merge(const Cluster&) {}
+	};
+
+	// The searcher is excluded from matching an execution context, so that a (non-const) context can be 
+	// supplied without a searcher
+	template<class ClusteringMethod, class ClusterVector, class Searcher>
+	typename std::enable_if<!std::is_base_of<ExecutionContext, Searcher>::value>::type
+	cluster_via_rnn(ClusteringMethod method, ClusterVector& clusters, NeighborCacheKinds, size_t cache_size, Searcher& searcher, const ExecutionContext& context=ExecutionContext()) {
+
+		typedef ClusterVector                            clusters_type;
+		typedef typename clusters_type::cluster_type     cluster_type;
+		typedef typename ClusteringMethod::distance_type distance_type;
+		
+		typedef Util::ActiveList<cluster_type>                   active_type;
+		typedef Util::NeighborCache<cluster_type, distance_type> cache_type;
+		typedef typename cache_type::entry_type                  cached_type;
+
+		// Result from nearest neighbor scans
+		typedef std::pair<cluster_type*, distance_type>  nearn_type;
+		
+		// Nearest neighbor chain
+		typedef std::pair<cluster_type*, distance_type> entry_type;
+
+		std::vector<entry_type> chain;
+		
+		size_t initial_clusters = clusters.size(), result_clusters = (initial_clusters * 2) - 1;
+		clusters.reserve(result_clusters);
+		
+		// List of valid clusters (used in merging)
+		Util::IndexList valid(initial_clusters);
+
+		// All clusters that have not yet been merged, chained or not
+		active_type active(clusters.begin(), clusters.end(), initial_clusters);
+		std::vector<bool> chained(initial_clusters, false);
+
+		// Nearest neighbors of each cluster from the most recent scan, or inherited from parents  
+		cache_type cache(initial_clusters, cache_size);
+		std::vector<nearn_type> nns;
+		nns.reserve(2 * cache_size);
+
+		// A single thread team is maintained for the entire clustering. The chain and cache are manipulated by 
+		// one thread, while all threads participate in the full nearest neighbor scans (and team merges). 
+		bool          scan   = false;  // Is a full nearest neighbor scan needed for the tip of the chain?
+		cluster_type* tip    = NULL;
+		cluster_type* merged = NULL;   // Newly merged cluster awaiting a team merge
+		NeighborSlots<distance_type> slots(context);
+
+#ifdef _OPENMP
+		#pragma omp parallel num_threads(context.threads()) shared(scan, tip, merged, slots, chain, clusters, active, chained, cache, nns, valid, method, searcher)
+#endif
+		while (true) {
+#ifdef _OPENMP
+			#pragma omp single
+#endif
+			while (true) {
+				merged = NULL;
+				if (scan) {
+					scan = false;
+					cache.assign(tip->idx(), nns.begin(), nns.end(), slots.bound);
 				} else {
-					// Tip of chain is recursive nearest neighbor
-					cluster_type* r = cluster_at_tip(chain);
-					distance_type d = distance_to_tip(chain);
-					chain.pop();
+					if (clusters.size() == result_clusters)
+						break;
 
-					cluster_type* l  = cluster_at_tip(chain);
-					chain.pop();
+					if (chain.empty()) {
+						cluster_type* c = active.back();
+						chain.push_back( entry_type(c, std::numeric_limits<distance_type>::max()) );
+						chained[c->idx()] = true;
+						RCLUSTERPP_STATS_ADD(CHAIN_PUSHES, 1);
+					}
+			
+					tip = chain.back().first;
+					size_t ti = tip->idx();
 
-					// Remove "tip" and "next tip"  from chain and merge into new cluster appended to "unchained" clusters
-					cluster_type* cn = ClusterVector::make_cluster(std::min(l->idx(), r->idx()), l, r, d);
+					// Update distances to the (possibly merged) cached neighbors of the tip
+					{
+						RCLUSTERPP_STATS_TIME(NEIGHBOR_TIME);
+						nns.clear();
+						for (cached_type* e=cache.begin(ti), *ee=cache.end(ti); e!=ee; ++e) {
+							cluster_type* c = active.at(cache.find(e->cluster->idx()));
+							if (c == tip || std::find_if(nns.begin(), nns.end(), Util::first_equal_to(c)) != nns.end())
+								continue;
+							bool known = e->known && c == e->cluster;
+							if (!known)
+								RCLUSTERPP_STATS_ADD(DISTANCES, 1);
+							nns.push_back( nearn_type(c, known ? e->distance : method.distancer(*tip, *c)) );
+						}
+						std::stable_sort(nns.begin(), nns.end(), Util::second_less());
+					}
+			
+					if (nns.empty() || nns.front().second > cache.bound(ti)) {
+						// Can't determine nearest neighbor from the cache, rescan all active clusters except for the tip
+						active.move_to_back(tip);
+						scan = true;
+						break;
+					}
 					
-					valid.remove(std::max(r->idx(), l->idx()));
-					method.merger(*cn, *(cn->parent1()), *(cn->parent2()), valid);
+					cache.assign(ti, nns.begin(), nns.end(), cache.bound(ti));
+				}
+
+				nearn_type nn = nns.front();
+				if (chain.size() == 1 || (nn.second < chain.back().second && !chained[nn.first->idx()])) {
+					chain.push_back( entry_type(nn.first, nn.second) );
+					chained[nn.first->idx()] = true;
+					RCLUSTERPP_STATS_ADD(CHAIN_PUSHES, 1);
+					RCLUSTERPP_STATS_MAX(MAX_CHAIN, chain.size());
+				} else {
+					RCLUSTERPP_STATS_TIME(MERGE_TIME);
+					RCLUSTERPP_STATS_ADD(CHAIN_POPS, 2);
+
+					// Tip of chain and the preceding cluster are recursive nearest neighbors
+					cluster_type* r = tip;
+					distance_type d = chain.back().second;
+					chain.pop_back();
+
+					cluster_type* l = chain.back().first;
+					chain.pop_back();
+
+					size_t into = std::min(l->idx(), r->idx()), from = std::max(l->idx(), r->idx());
+					cluster_type* cn = clusters.make_cluster(into, l, r, d);
 					
+					valid.remove(from);
+					if (ClusteringMethod::merger_type::team_merge) {
+						merged = cn;
+					} else {
+						method.merger(*cn, *(cn->parent1()), *(cn->parent2()), valid);
+						searcher.merge(*cn);
+					}
+
+					chained[l->idx()] = chained[r->idx()] = false;
+					active.remove(l);
+					active.remove(r);
+					active.insert(cn);
+					cache.merge(into, from);
+
 					clusters.push_back(cn);
+					if (merged)
+						break;
 				}
 			}
+
+			if (merged) {
+				RCLUSTERPP_STATS_TEAM_TIME(MERGE_TIME);
+				method.merger(*merged, *(merged->parent1()), *(merged->parent2()), valid);
+#ifdef _OPENMP
+				#pragma omp single
+#endif
+				searcher.merge(*merged);
+				continue;
+			}
+
+			if (!scan)
+				break;
+
+			searcher.team_search(active, tip, method.distancer, cache.capacity(), nns, slots);
 		}
-	
-		// Cleanup cluster listing
+
+		sort_agglomerations(clusters);
+	}
+
+	template<class ClusteringMethod, class ClusterVector>
+	void cluster_via_rnn(ClusteringMethod method, ClusterVector& clusters, NeighborCacheKinds, size_t cache_size=8, const ExecutionContext& context=ExecutionContext()) {
+		ScanNeighbors searcher;
+		cluster_via_rnn(method, clusters, CachedNeighbors, cache_size, searcher, context);
+	}
+
+	// RNN agglomeration with many chains grown in parallel. Following nearest neighbors from any cluster traces a 
+	// chain that ends in a pair of reciprocal nearest neighbors, and for reducible linkages merging one such pair 
+	// doesn't change the nearest neighbors of the other clusters (a merged cluster is no closer to a third cluster
+	// than the nearer of its parents). Thus the chains from all of the clusters are grown at once, and all of the 
+	// reciprocal pairs at their ends are merged in the same round. In each round the nearest neighbor scans for the 
+	// clusters whose neighbor was merged (and the newly merged clusters) are divided among the threads, so the 
+	// parallelism is coarse-grained. Nearest neighbor ties are broken by idx and the pairs are merged in order of 
+	// idx, so that the clustering does not depend on the number of threads. 
+	template<class ClusteringMethod, class ClusterVector>
+	void cluster_via_rnn(ClusteringMethod method, ClusterVector& clusters, ParallelChainKinds, const ExecutionContext& context=ExecutionContext()) {
 		
-		// Re-order the clusters, with initial clusters in the beginning, ordered by id
-		// from -1 .. -initial_clusters, followed by the agglomerated clusters sorted by
-		// increasing disimilarity. Stable partition and stable sorting is required for
-    // the latter to ensure merge order is maintaining for clusters with identical
-    // dissimilarity.
+		typedef ClusterVector                            clusters_type;
+		typedef typename clusters_type::cluster_type     cluster_type;
+		typedef typename ClusteringMethod::distance_type distance_type;
 		
-    // Note, sort requires strict weak ordering and will fail in a data dependent way
-    // if the comparison function does not satisfy that requirement
-    
-		typename clusters_type::iterator part = std::stable_partition(clusters.begin(), clusters.end(), std::mem_fn(&cluster_type::initial));
-    std::sort(clusters.begin(), part, &compare_id<cluster_type>); 
-		std::stable_sort(part, clusters.end(), &compare_disimilarity<cluster_type>); 
+		typedef Util::ActiveList<cluster_type>            active_type;
+		typedef std::pair<cluster_type*, cluster_type*>   pair_type;
 
-		for (size_t i=initial_clusters; i<result_clusters; i++) {
-			clusters[i]->set_id(i - initial_clusters + 1);  // Use R hclust 1-indexed convention for Id's
+		size_t initial_clusters = clusters.size(), result_clusters = (initial_clusters * 2) - 1;
+		clusters.reserve(result_clusters);
+		
+		// List of valid clusters (used in merging)
+		Util::IndexList valid(initial_clusters);
+
+		// All clusters that have not yet been merged
+		active_type active(clusters.begin(), clusters.end(), initial_clusters);
+		
+		// Nearest neighbor (idx) of each active cluster, and the distance to that neighbor, indexed by idx
+		std::vector<size_t>        neighbor(initial_clusters);
+		std::vector<distance_type> distance(initial_clusters);
+		std::vector<bool>          changed(initial_clusters, false);  // Was the cluster at idx merged in this round?
+
+		std::vector<cluster_type*> stale(active.begin(), active.end());  // Clusters that need a nearest neighbor scan
+		std::vector<pair_type>     pairs;
+		cluster_type*              merged = NULL;
+
+		// A single thread team is maintained for the entire clustering. All threads participate in the scans (and 
+		// team merges), while the reciprocal pairs are found and merged by one thread.
+#ifdef _OPENMP
+		#pragma omp parallel num_threads(context.threads()) shared(active, neighbor, distance, changed, stale, pairs, merged, clusters, valid, method)
+#endif
+		while (clusters.size() < result_clusters) {
+			{
+				RCLUSTERPP_STATS_TEAM_TIME(NEIGHBOR_TIME);
+#ifdef _OPENMP
+				#pragma omp for schedule(dynamic)
+#endif
+				for (ssize_t s=0; s<(ssize_t)stale.size(); s++) {
+					cluster_type* c = stale[s];
+					RCLUSTERPP_STATS_ADD(DISTANCES, active.size() - 1);
+
+					distance_type min_d = std::numeric_limits<distance_type>::max();
+					size_t        min_i = std::numeric_limits<size_t>::max();
+					for (typename active_type::iterator a=active.begin(), ae=active.end(); a!=ae; ++a) {
+						cluster_type* o = *a;
+						if (o == c)
+							continue;
+						// Distances are always computed from the lesser idx so that they are symmetric 
+						distance_type d = (c->idx() < o->idx()) ? method.distancer(*c, *o, min_d) : method.distancer(*o, *c, min_d);
+						if (d < min_d || (d == min_d && o->idx() < min_i)) {
+							min_d = d;
+							min_i = o->idx();
+						}
+					}
+					neighbor[c->idx()] = min_i;
+					distance[c->idx()] = min_d;
+				}
+			}
+
+#ifdef _OPENMP
+			#pragma omp single
+#endif
+			{
+				pairs.clear();
+				for (typename active_type::iterator a=active.begin(), ae=active.end(); a!=ae; ++a) {
+					size_t i = (*a)->idx(), j = neighbor[i];
+					if (i < j && neighbor[j] == i)
+						pairs.push_back( pair_type(*a, active.at(j)) );
+				}
+				if (pairs.empty()) {
+					// Nearest neighbors that tie can form a cycle without a reciprocal pair, but the closest pair 
+					// of clusters are always reciprocal nearest neighbors
+					cluster_type* c = active.back();
+					for (typename active_type::iterator a=active.begin(), ae=active.end(); a!=ae; ++a) {
+						size_t i = (*a)->idx();
+						if (distance[i] < distance[c->idx()] || (distance[i] == distance[c->idx()] && i < c->idx()))
+							c = *a;
+					}
+					pairs.push_back( pair_type(c, active.at(neighbor[c->idx()])) );
+				}
+				std::sort(pairs.begin(), pairs.end(), Util::pair_less_idx());
+			}
+
+			{
+				RCLUSTERPP_STATS_TEAM_TIME(MERGE_TIME);
+				for (size_t p=0; p<pairs.size(); p++) {
+#ifdef _OPENMP
+					#pragma omp single
+#endif
+					{
+						cluster_type* l = pairs[p].first, *r = pairs[p].second;
+						
+						size_t into = std::min(l->idx(), r->idx()), from = std::max(l->idx(), r->idx());
+						merged = clusters.make_cluster(into, l, r, distance[l->idx()]);
+						
+						valid.remove(from);
+						if (!ClusteringMethod::merger_type::team_merge)
+							method.merger(*merged, *(merged->parent1()), *(merged->parent2()), valid);
+
+						changed[into] = changed[from] = true;
+						active.remove(l);
+						active.remove(r);
+						active.insert(merged);
+						
+						clusters.push_back(merged);
+					}
+					
+					if (ClusteringMethod::merger_type::team_merge)
+						method.merger(*merged, *(merged->parent1()), *(merged->parent2()), valid);
+				}
+			}
+
+#ifdef _OPENMP
+			#pragma omp single
+#endif
+			{
+				// Only the clusters whose nearest neighbor was merged (including the merged clusters) need to be rescanned
+				stale.clear();
+				for (typename active_type::iterator a=active.begin(), ae=active.end(); a!=ae; ++a) {
+					size_t i = (*a)->idx();
+					if (changed[i] || changed[neighbor[i]])
+						stale.push_back(*a);
+				}
+				for (size_t p=0; p<pairs.size(); p++) {
+					changed[pairs[p].first->idx()] = changed[pairs[p].second->idx()] = false;
+				}
+			}
 		}
 
+		sort_agglomerations(clusters);
 	}
 
 	namespace {
@@ -167,7 +665,7 @@ namespace Rclusterpp {
 	} // end of anonymous namespace		
 
 	template<class Distancer, class ClusterVector>
-	void cluster_via_slink(const Distancer& distancer, ClusterVector& clusters) {
+	void cluster_via_slink(const Distancer& distancer, ClusterVector& clusters, const ExecutionContext& context=ExecutionContext()) {
 
 		typedef typename Distancer::result_type distance_type;
 
@@ -185,11 +683,12 @@ namespace Rclusterpp {
 
 			// Step 2: Build out pairwise distances from objects in pointer
 			// represenation to the new object
+			RCLUSTERPP_STATS_ADD(DISTANCES, i);
 #ifdef _OPENMP	
-			#pragma omp parallel for shared(i, M)
+			#pragma omp parallel for num_threads(context.threads()) shared(i, M)
 #endif
-			for (ssize_t j=0; j<(ssize_t)i; j++) {
-				M[j] = distancer(i, j); 
+			for (ssize_t j=0; j<(ssize_t)i; j+=256) {
+				distancer.distances(i, j, std::min<size_t>(256, i - j), &M[j]); 
 			}
 
 			// Step 3: Update M, P, L
@@ -222,7 +721,7 @@ namespace Rclusterpp {
 		}
 		for (size_t i=0; i<(initial_clusters-1); i++) {
 			size_t f = from(merges[i]), t = into(merges[i]);
-			clusters.push_back(ClusterVector::make_cluster( 0, clusters[P[f]], clusters[P[t]], L[f] ));
+			clusters.push_back(clusters.make_cluster( 0, clusters[P[f]], clusters[P[t]], L[f] ));
 			P[t] = i + initial_clusters;
 		}
 		
@@ -233,6 +732,305 @@ namespace Rclusterpp {
 		
 	}
 
+	// Single linkage via the minimum spanning tree (MST), which is built with Prim's algorithm computing the
+	// distances on the fly (O(n^2) distance computations with O(n) memory). A single thread team is maintained
+	// for the entire construction, with all threads participating in both the distance updates and the search
+	// for the next point to add to the tree. The merges are then obtained from the MST edges in order of 
+	// increasing distance. The distances from the newest point in the tree to the points outside of it are
+	// computed a tile at a time with the distancer's distances(), e.g., from precomputed norms and inner products.
+	template<class Distancer, class ClusterVector>
+	void cluster_via_mst(const Distancer& distancer, ClusterVector& clusters, const ExecutionContext& context=ExecutionContext()) {
+
+		typedef typename Distancer::result_type distance_type;
+		typedef std::pair<distance_type, ssize_t> entry_type;  // Distance to, and position of, next point
+
+		const ssize_t tile = 256;
+
+		size_t initial_clusters = clusters.size(), result_clusters = (initial_clusters * 2) - 1;
+		clusters.reserve(result_clusters);
+
+		// Points outside of the tree (in increasing order), along with their distance to, and nearest
+		// point in, the tree. Points added to the tree are removed (maintaining the order), so that the
+		// points outside of the tree can be passed to the distancer directly.
+		std::vector<size_t>        outside;
+		std::vector<distance_type> D;
+		std::vector<size_t>        nearest;
+		for (size_t i=1; i<initial_clusters; i++) {
+			outside.push_back(i);
+			D.push_back(std::numeric_limits<distance_type>::max());
+			nearest.push_back(0);
+		}
+		
+		// MST edges (from, into) in the order they are added, with L[from] the length of the edge
+		std::vector<Merge_t>       edges;
+		std::vector<distance_type> L(initial_clusters);
+		edges.reserve(initial_clusters);
+
+		size_t current = 0, remaining = outside.size();
+		Util::TeamSlots<entry_type> slots(context.threads());
+
+#ifdef _OPENMP
+		#pragma omp parallel num_threads(context.threads()) shared(current, remaining, outside, D, nearest, edges, L, slots)
+#endif
+		while (remaining > 0) {
+			ssize_t       n = outside.size();
+			entry_type    min_l(std::numeric_limits<distance_type>::max(), n);
+			distance_type d[tile];
+			RCLUSTERPP_STATS_TEAM_ADD(DISTANCES, remaining);
+			
+#ifdef _OPENMP
+			#pragma omp for schedule(static) nowait
+#endif
+			for (ssize_t t=0; t<n; t+=tile) {
+				ssize_t nt = std::min(tile, n - t);
+				distancer.distances(current, &outside[t], nt, d);
+				for (ssize_t j=0; j<nt; j++) {
+					ssize_t k = t + j;
+					if (d[j] < D[k]) {
+						D[k]       = d[j];
+						nearest[k] = current;
+					}
+					min_l = std::min(min_l, entry_type(D[k], k));  // Ties broken by position, i.e., by point
+				}
+			}
+
+			slots.local() = min_l;
+			
+#ifdef _OPENMP
+			#pragma omp barrier
+			#pragma omp single
+#endif
+			{
+				entry_type min(std::numeric_limits<distance_type>::max(), n);
+				for (int t=0, te=Util::team_size(); t<te; t++) {
+					min = std::min(min, slots[t]);
+				}
+				
+				size_t k = min.second;
+				edges.push_back(make_merge(outside[k], nearest[k]));  // from, into
+				L[outside[k]] = D[k];
+
+				current = outside[k];
+				outside.erase(outside.begin() + k);
+				D.erase(D.begin() + k);
+				nearest.erase(nearest.begin() + k);
+				remaining--;
+			}
+		}
+
+		// Convert the MST to a dendrogram, tracking the current cluster for each point with union-find 
+		std::stable_sort(edges.begin(), edges.end(), MergeCMP<std::vector<distance_type> >(L));
+		
+		std::vector<size_t> root(initial_clusters), P(initial_clusters);
+		for (size_t i=0; i<initial_clusters; i++) {
+			root[i] = P[i] = i;
+		}
+		for (size_t i=0; i<edges.size(); i++) {
+			size_t f = from(edges[i]), t = into(edges[i]);
+			while (root[f] != f)
+				f = root[f] = root[root[f]];
+			while (root[t] != t)
+				t = root[t] = root[root[t]];
+			
+			clusters.push_back(clusters.make_cluster( 0, clusters[P[f]], clusters[P[t]], L[from(edges[i])] ));
+			root[f] = t;
+			P[t]    = i + initial_clusters;
+		}
+		
+		for (size_t i=initial_clusters; i<result_clusters; i++) {
+			clusters[i]->set_id(i - initial_clusters + 1);  // Use R hclust 1-indexed convention for Id's
+		}
+	}
+
+	// Generic clustering for any linkage, including the non-reducible centroid and median linkages for which
+	// the RNN engines are not correct. Each active cluster tracks its nearest neighbor among the active clusters 
+	// with larger idxs, and the clusters are kept in a min-heap keyed by the distance to that neighbor. Updates 
+	// are lazy: when a neighbor is merged away, or might now be farther away, the key is left as a lower bound
+	// and the neighbor is only recomputed if the cluster reaches the top of the heap. The merged cluster takes
+	// the lesser of the two merged idxs. Merges are recorded in the order performed, since the dissimilarities
+	// need not be monotonic. A single thread team is maintained for the entire clustering, with all threads
+	// participating in the team merges and the distance computations.
+	template<class ClusteringMethod, class ClusterVector>
+	void cluster_via_heap(ClusteringMethod method, ClusterVector& clusters, const ExecutionContext& context=ExecutionContext()) {
+
+		typedef ClusterVector                            clusters_type;
+		typedef typename clusters_type::cluster_type     cluster_type;
+		typedef typename ClusteringMethod::distance_type distance_type;
+		typedef std::pair<distance_type, size_t>         entry_type;  // Distance to, and idx of, neighbor
+
+		enum { Select, Update, Scan, Done } phase = Select;
+		
+		size_t initial_clusters = clusters.size(), result_clusters = (initial_clusters * 2) - 1;
+		clusters.reserve(result_clusters);
+
+		Util::IndexList valid(initial_clusters);
+		
+		// Active clusters by idx (NULL once merged away), and the nearest neighbor of each active cluster
+		// among those with larger idxs. The heap key is a lower bound on the distance to the neighbor, and
+		// is exact (and the neighbor current) only when exact is set.
+		std::vector<cluster_type*>       active(initial_clusters);
+		std::vector<size_t>              neighbor(initial_clusters);
+		std::vector<bool>                exact(initial_clusters, true);
+		Util::IndexedHeap<distance_type> heap(initial_clusters);
+		
+		for (size_t i=0; i<initial_clusters; i++) {
+			active[clusters[i]->idx()] = clusters[i];
+		}
+
+		std::vector<distance_type> D(initial_clusters);  // Distances to the newly merged (or initial) clusters
+		
+		size_t        scan   = 0;     // Idx of the cluster whose neighbor is being recomputed
+		size_t        from   = 0;     // Idx of the cluster merged away
+		cluster_type* merged = NULL;  // Newly merged cluster
+		Util::TeamSlots<entry_type> slots(context.threads());
+
+#ifdef _OPENMP
+		#pragma omp parallel num_threads(context.threads()) shared(phase, valid, active, neighbor, exact, heap, D, scan, from, merged, slots, clusters, method)
+#endif
+		{
+			const ssize_t n = initial_clusters;
+			
+#ifdef _OPENMP
+			#pragma omp for schedule(dynamic, 16)
+#endif
+			for (ssize_t i=0; i<n-1; i++) {
+				entry_type min(std::numeric_limits<distance_type>::max(), n);
+				RCLUSTERPP_STATS_ADD(DISTANCES, n - 1 - i);
+				for (ssize_t j=i+1; j<n; j++) {
+					distance_type d = method.distancer(*active[i], *active[j]);
+					if (d < min.first)
+						min = entry_type(d, j);
+				}
+				D[i]        = min.first;
+				neighbor[i] = min.second;
+			}
+
+#ifdef _OPENMP
+			#pragma omp single
+#endif
+			for (ssize_t i=0; i<n-1; i++) {
+				heap.push(i, D[i]);
+			}
+
+			while (true) {
+#ifdef _OPENMP
+				#pragma omp single
+#endif
+				{
+					if (phase == Update) {
+						// Merged cluster is the new (possibly lazy) neighbor of any lesser cluster whose neighbor was
+						// either parent, and the exact neighbor of any lesser cluster that is now closer to it
+						size_t into = merged->idx();
+						for (size_t p=0, pe=valid.position(into); p<pe; p++) {
+							size_t i = valid[p];
+							bool   parent = (neighbor[i] == into || neighbor[i] == from);
+							if (D[i] < heap.key(i) || (parent && !(heap.key(i) < D[i]))) {
+								neighbor[i] = into;
+								exact[i]    = true;
+								heap.update(i, D[i]);
+							} else if (parent) {
+								neighbor[i] = into;
+								exact[i]    = false;
+							}
+						}
+						phase = Scan;
+					}
+
+					if (phase == Scan) {
+						entry_type min(std::numeric_limits<distance_type>::max(), n);
+						for (int t=0, te=Util::team_size(); t<te; t++) {
+							min = std::min(min, slots[t]);
+						}
+						if (min.second < (size_t)n) {
+							neighbor[scan] = min.second;
+							exact[scan]    = true;
+							heap.update(scan, min.first);
+						} else {
+							heap.remove(scan);  // No active clusters with larger idxs remain
+						}
+						phase = Select;
+					}
+
+					while (phase == Select) {
+						if (clusters.size() == result_clusters) {
+							phase = Done;
+							break;
+						}
+
+						size_t a = heap.top(), b = neighbor[a];
+						if (!exact[a] || active[b] == NULL) {
+							scan  = a;
+							phase = Scan;
+							break;
+						}
+
+						// Merge the two clusters into the lesser idx (a), removing the other (b) 
+						merged = clusters.make_cluster(a, active[a], active[b], heap.key(a));
+						from   = b;
+
+						valid.remove(b);
+						active[b] = NULL;
+						if (heap.contains(b))
+							heap.remove(b);
+						
+						if (!ClusteringMethod::merger_type::team_merge)
+							method.merger(*merged, *(merged->parent1()), *(merged->parent2()), valid);
+						
+						active[a] = merged;
+						clusters.push_back(merged);
+						
+						scan  = a;
+						phase = Update;
+					}
+				}
+
+				if (phase == Done)
+					break;
+
+				if (phase == Update) {
+					if (ClusteringMethod::merger_type::team_merge)
+						method.merger(*merged, *(merged->parent1()), *(merged->parent2()), valid);
+
+					// Distances from the lesser clusters to the merged cluster
+					ssize_t pa = valid.position(merged->idx());
+					RCLUSTERPP_STATS_TEAM_ADD(DISTANCES, pa);
+#ifdef _OPENMP
+					#pragma omp for schedule(static) nowait
+#endif
+					for (ssize_t p=0; p<pa; p++) {
+						size_t i = valid[p];
+						D[i] = method.distancer(*active[i], *merged);
+					}
+				}
+
+				// Nearest neighbor of the cluster at scan among those with larger idxs 
+				{
+					ssize_t    ps = valid.position(scan) + 1, pe = valid.size();
+					entry_type min_l(std::numeric_limits<distance_type>::max(), n);
+					cluster_type const* c = active[scan];
+					RCLUSTERPP_STATS_TEAM_ADD(DISTANCES, pe - ps);
+#ifdef _OPENMP
+					#pragma omp for schedule(static) nowait
+#endif
+					for (ssize_t p=ps; p<pe; p++) {
+						size_t        i = valid[p];
+						distance_type d = method.distancer(*c, *active[i]);
+						min_l = std::min(min_l, entry_type(d, i));
+					}
+					slots.local() = min_l;
+				}
+
+#ifdef _OPENMP
+				#pragma omp barrier
+#endif
+			}
+		}
+
+		for (size_t i=initial_clusters; i<result_clusters; i++) {
+			clusters[i]->set_id(i - initial_clusters + 1);  // Use R hclust 1-indexed convention for Id's
+		}
+	}
+
 } // end of Rclustercpp namespace
 
 #endif
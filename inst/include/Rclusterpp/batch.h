@@ -0,0 +1,86 @@
+#ifndef RCLUSTERPP_BATCH_H
+#define RCLUSTERPP_BATCH_H
+
+#include <vector>
+#include <string>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+
+#include <Rclusterpp/util.h>
+
+namespace Rclusterpp {
+
+	namespace Util {
+
+		template<class T>
+		struct IndexGreater {
+			const std::vector<T>& values;
+			IndexGreater(const std::vector<T>& v) : values(v) {}
+			bool operator()(size_t a, size_t b) const { return values[a] > values[b] || (!(values[b] > values[a]) && a < b); }
+		};
+
+	} // end of Util namespace
+
+	// Run a batch of independent jobs, e.g., clusterings of many small data sets, where job(i, context) runs job i
+	// with the given execution context and sizes[i] is the size of job i (e.g., the number of observations). Jobs of
+	// at least parallel_size are run one at a time, each with all of the threads of the context, since they
+	// have enough work to use the parallelism within the job. The remaining jobs are run concurrently, one per
+	// thread, with idle threads taking the largest of the remaining jobs (dynamic scheduling), so that many small
+	// jobs can keep all of the threads busy. Jobs must not use R. If any job throws, the remaining jobs are
+	// skipped and the (first) error is rethrown once the team has finished.
+	template<class Job>
+	void run_batch(const std::vector<size_t>& sizes, size_t parallel_size, const Job& job, const ExecutionContext& context) {
+
+		std::vector<size_t> jobs(sizes.size());
+		std::iota(jobs.begin(), jobs.end(), 0);
+		std::sort(jobs.begin(), jobs.end(), Util::IndexGreater<size_t>(sizes));
+
+		size_t parallel = 0;  // Jobs [0, parallel) are large enough to run with the entire team
+		while (parallel < jobs.size() && sizes[jobs[parallel]] >= parallel_size)
+			parallel++;
+
+		for (size_t j=0; j<parallel; j++) {
+			job(jobs[j], context);
+		}
+
+		ExecutionContext serial(1);
+		bool             failed = false;
+		std::string      error;
+
+#ifdef _OPENMP
+		#pragma omp parallel for num_threads(context.threads()) schedule(dynamic, 1) shared(jobs, failed, error, serial)
+#endif
+		for (ssize_t j=parallel; j<(ssize_t)jobs.size(); j++) {
+			bool skip;
+#ifdef _OPENMP
+			#pragma omp atomic read
+#endif
+			skip = failed;
+			if (skip)
+				continue;
+
+			try {
+				job(jobs[j], serial);
+			} catch (std::exception& e) {
+#ifdef _OPENMP
+				#pragma omp critical (rclusterpp_batch_error)
+#endif
+				{
+					if (error.empty())
+						error = e.what();
+#ifdef _OPENMP
+					#pragma omp atomic write
+#endif
+					failed = true;
+				}
+			}
+		}
+
+		if (failed)
+			throw std::runtime_error(error);
+	}
+
+} // end of Rclusterpp namespace
+
+#endif
@@ -3,6 +3,12 @@
 
 #include <limits>
 #include <vector>
+#include <new>
+#include <utility>
+#include <iterator>
+#include <type_traits>
+
+#include <Rclusterpp/stats.h>
 
 namespace Rclusterpp {
 	
@@ -17,10 +23,11 @@ namespace Rclusterpp {
 		public:
 
 			Cluster(ssize_t id, size_t idx) : 
-				id_(id), idx_(idx), size_(1), parent1_(NULL), parent2_(NULL), disimilarity_(0) {}
+				id_(id), idx_(idx), size_(1), weight_(1), parent1_(NULL), parent2_(NULL), disimilarity_(0) {}
 			
 			Cluster(size_t idx, Derived const * parent1, Derived const * parent2, distance_type disimilarity) :
-				id_(NULLID()), idx_(idx), size_(parent1->size()+parent2->size()), parent1_(parent1), parent2_(parent2), disimilarity_(disimilarity) {}
+				id_(NULLID()), idx_(idx), size_(parent1->size()+parent2->size()), weight_(parent1->weight()+parent2->weight()), 
+				parent1_(parent1), parent2_(parent2), disimilarity_(disimilarity) {}
 							
 			ssize_t id() const { return id_; }
 			void set_id(ssize_t id) { id_ = id; } 
@@ -30,6 +37,11 @@ namespace Rclusterpp {
 
 			size_t size() const { return size_; }
 
+			// Weight (e.g., number of pre-aggregated observations) used by the linkages in place of the size. Initial 
+			// clusters default to a weight of one, and merged clusters are weighted by the sum of their parents.
+			distance_type weight() const { return weight_; }
+			void set_weight(distance_type weight) { weight_ = weight; }
+
 			bool initial() const { return parent1_ == NULL || parent2_ == NULL; }
 			
 			Derived const * parent1() const { return parent1_; }
@@ -48,6 +60,7 @@ namespace Rclusterpp {
 			ssize_t id_;
 			size_t  idx_;
 			size_t  size_;
+			distance_type weight_;
 	
 			Derived const * parent1_;
 			Derived const * parent2_;
@@ -67,13 +80,14 @@ namespace Rclusterpp {
 	}
 
 
-	class ClusterWithID : public Cluster<ClusterWithID> {
+	template<class Distance>
+	class ClusterWithID : public Cluster<ClusterWithID<Distance>, Distance> {
 		private:
-			typedef Cluster<ClusterWithID> base_class;
+			typedef Cluster<ClusterWithID<Distance>, Distance> base_class;
 		
 		public:
 
-			typedef base_class::distance_type distance_type;
+			typedef typename base_class::distance_type distance_type;
 			
 		public:	
 			
@@ -89,9 +103,9 @@ namespace Rclusterpp {
 
 
 	template<class Value>
-	class ClusterWithCenter : public Cluster<ClusterWithCenter<Value> > {
+	class ClusterWithCenter : public Cluster<ClusterWithCenter<Value>, Value> {
 		private:
-			typedef Cluster<ClusterWithCenter<Value> > base_class;
+			typedef Cluster<ClusterWithCenter<Value>, Value> base_class;
 		
 		public:
 
@@ -117,41 +131,137 @@ namespace Rclusterpp {
 			center_type center_;
 	};
 
-	class ClusterWithObs : public Cluster<ClusterWithObs> {
+	// Observations are tracked as a singly-linked list threaded through the initial clusters. A merged
+	// cluster's list is the concatenation of its parents' lists, which requires only that the tail of 
+	// the first parent be linked to the head of the second. Since iteration is bounded by the size of 
+	// the cluster, the parents' lists remain valid after merging.
+	template<class Distance>
+	class ClusterWithObs : public Cluster<ClusterWithObs<Distance>, Distance> {
 		private:
-			typedef Cluster<ClusterWithObs> base_class;
+			typedef Cluster<ClusterWithObs<Distance>, Distance> base_class;
 
 		public:
 			
-			typedef base_class::distance_type distance_type;
+			typedef typename base_class::distance_type distance_type;
 			typedef std::vector<size_t>       idx_type;
 
-			typedef idx_type::iterator       idx_iterator;
-			typedef idx_type::const_iterator idx_const_iterator;
+			class idx_const_iterator {
+				public:
+					typedef std::forward_iterator_tag iterator_category;
+					typedef size_t                    value_type;
+					typedef ptrdiff_t                 difference_type;
+					typedef const size_t*             pointer;
+					typedef const size_t&             reference;
+
+					idx_const_iterator(ClusterWithObs const * c, size_t n) : c_(c), n_(n) {}
+
+					reference operator*() const { return c_->obs_; }
+					pointer operator->() const { return &(c_->obs_); }
+
+					distance_type weight() const { return c_->weight(); }  // Weight of the observation
+
+					idx_const_iterator& operator++() { c_ = c_->next_; --n_; return *this; }
+					idx_const_iterator operator++(int) { idx_const_iterator i(*this); ++(*this); return i; }
+
+					bool operator==(const idx_const_iterator& o) const { return n_ == o.n_; }
+					bool operator!=(const idx_const_iterator& o) const { return n_ != o.n_; }
+
+				private:
+					ClusterWithObs const * c_;
+					size_t                 n_;  // Remaining observations
+			};
 
 		public:
 
 			ClusterWithObs(size_t idx, ClusterWithObs const * parent1, ClusterWithObs const * parent2, distance_type disimilarity) : 
-				base_class(idx, parent1, parent2, disimilarity), idxs_(parent1->idxs()) {
+				base_class(idx, parent1, parent2, disimilarity), obs_(0), head_(parent1->head_), tail_(parent2->tail_), next_(NULL) {
 				
-				// Append "merged" observation idxs	
-				idxs_.insert(idxs_.end(), parent2->idxs_begin(), parent2->idxs_end());
+				// Append "merged" observations
+				parent1->tail_->next_ = parent2->head_;
 			} 
 
 			template<class V>
 			ClusterWithObs(ssize_t id, size_t obs_id, const V& vector) : 
-				base_class(id, obs_id), idxs_(1, obs_id) {}
+				base_class(id, obs_id), obs_(obs_id), head_(this), tail_(this), next_(NULL) {}
 	
-			const idx_type& idxs() const { return idxs_; }
-			idx_const_iterator idxs_begin() const { return idxs_.begin(); }
-			idx_const_iterator idxs_end()   const { return idxs_.end(); }
+			idx_type idxs() const { return idx_type(idxs_begin(), idxs_end()); }
+			idx_const_iterator idxs_begin() const { return idx_const_iterator(head_, this->size()); }
+			idx_const_iterator idxs_end()   const { return idx_const_iterator(NULL, 0); }
 
 		private:
 
-			idx_type        idxs_;
+			size_t                 obs_;  // Observation for initial clusters
+			ClusterWithObs const * head_;
+			ClusterWithObs const * tail_;
+			
+			mutable ClusterWithObs const * next_;  // Next observation in list, updated when merging
+	};
+
+	// Storage policies for clusters in ClusterVector. Clusters are only created and destroyed 
+	// through the policy, and all clusters are destroyed before the policy.
+
+	// Allocate each cluster individually on the heap
+	template<class T>
+	class HeapClusterStorage {
+		public:
+			HeapClusterStorage(size_t n) : created_(0) {}
+
+			template<class... Args>
+			T* create(Args&&... args) { 
+				RCLUSTERPP_STATS_ALLOCATED(memory_, ++created_ * sizeof(T));
+				return new T(std::forward<Args>(args)...); 
+			}
+
+			void destroy(T* c) { delete c; }
+
+		private:
+			size_t created_;
+			RCLUSTERPP_STATS_MEMORY(memory_)
 	};
 
+	// Carve clusters out of a few large blocks that are released together. The first block is sized
+	// for the 2n-1 clusters created when agglomerating n initial clusters. Not thread-safe.
+	//
+	// Clusters in the arena can't own memory of their own (e.g., ClusterWithCenter), which would defeat
+	// the arena. Payloads such as centers and moments are instead stored contiguously by cluster idx 
+	// (see Methods::StoredCenters and Methods::StoredMoments).
 	template<class T>
+	class ArenaClusterStorage {
+			static_assert(std::is_trivially_destructible<T>::value, "Clusters in an arena must not own memory, store payloads by idx instead");
+
+		public:
+			ArenaClusterStorage(size_t n) : block_size_(std::max<size_t>(2 * n, 2) - 1), used_(block_size_) {}
+
+			~ArenaClusterStorage() {
+				for (size_t i=0; i<blocks_.size(); i++)
+					::operator delete(blocks_[i]);
+			}
+
+			template<class... Args>
+			T* create(Args&&... args) {
+				if (used_ == block_size_) {
+					blocks_.reserve(blocks_.size() + 1);
+					blocks_.push_back(static_cast<T*>(::operator new(block_size_ * sizeof(T))));
+					used_ = 0;
+					RCLUSTERPP_STATS_ALLOCATED(memory_, blocks_.size() * block_size_ * sizeof(T));
+				}
+				T* c = new (blocks_.back() + used_) T(std::forward<Args>(args)...);
+				used_++;
+				return c;
+			}
+
+			void destroy(T* c) { c->~T(); }
+
+		private:
+			ArenaClusterStorage(const ArenaClusterStorage&);
+			ArenaClusterStorage& operator=(const ArenaClusterStorage&);
+
+			size_t          block_size_, used_;
+			std::vector<T*> blocks_;
+			RCLUSTERPP_STATS_MEMORY(memory_)
+	};
+
+	template<class T, class Storage>
 	class ClusterVector {
 		private:
 
@@ -159,7 +269,8 @@ namespace Rclusterpp {
 		
 		public:
 
-			typedef T cluster_type;
+			typedef T       cluster_type;
+			typedef Storage storage_type;
 			typedef typename cluster_type::distance_type      distance_type;
 			typedef typename underlying_type::value_type      value_type;
 			typedef typename underlying_type::reference       reference;
@@ -168,11 +279,11 @@ namespace Rclusterpp {
 			typedef typename underlying_type::const_iterator  const_iterator;
 			typedef typename underlying_type::size_type       size_type;
 		
-			ClusterVector(size_t n) : initial_(n), clusters_(n, 0) {}
+			ClusterVector(size_t n) : initial_(n), storage_(n), clusters_(n, 0) { allocated(); }
 			
 			~ClusterVector() {
 				for (iterator i=begin(), e=end(); i!=e; ++i)
-					delete *i;
+					if (*i) storage_.destroy(*i);
 			}
 
 			iterator begin() { return clusters_.begin(); }
@@ -182,25 +293,25 @@ namespace Rclusterpp {
 			const_iterator end() const { return clusters_.end(); }
 
 			size_type size() const { return clusters_.size(); }
-			void reserve(size_type n) { clusters_.reserve(n); }
+			void reserve(size_type n) { clusters_.reserve(n); allocated(); }
 
 			reference operator[](size_type n) { return clusters_[n]; }
 			const_reference operator[](size_type n) const { return clusters_[n]; }
-			void push_back(const value_type& v) { clusters_.push_back(v); }
+			void push_back(const value_type& v) { clusters_.push_back(v); allocated(); }
 
 			size_t initial_clusters() const { return initial_; }
 
-			static cluster_type* make_cluster(ssize_t id, size_t obs_id) {
-				return new cluster_type(id, obs_id);
+			cluster_type* make_cluster(ssize_t id, size_t obs_id) {
+				return storage_.create(id, obs_id);
 			}
 
 			template<class Vector>
-			static cluster_type* make_cluster(ssize_t id, size_t obs_id, const Vector& vector) {
-				return new cluster_type(id, obs_id, vector);
+			cluster_type* make_cluster(ssize_t id, size_t obs_id, const Vector& vector) {
+				return storage_.create(id, obs_id, vector);
 			}
 
-			static cluster_type* make_cluster(size_t idx, cluster_type const * parent1, cluster_type const * parent2, distance_type disimilarity) {
-				return new cluster_type(idx, parent1, parent2, disimilarity);
+			cluster_type* make_cluster(size_t idx, cluster_type const * parent1, cluster_type const * parent2, distance_type disimilarity) {
+				return storage_.create(idx, parent1, parent2, disimilarity);
 			}
 
 
@@ -209,8 +320,12 @@ namespace Rclusterpp {
 			ClusterVector() {}
 			explicit ClusterVector(const ClusterVector& v);
 
+			void allocated() { RCLUSTERPP_STATS_ALLOCATED(memory_, clusters_.capacity() * sizeof(value_type)); }
+
 			size_t          initial_;  // Number of initial clusters
+			storage_type    storage_;
 			underlying_type clusters_;
+			RCLUSTERPP_STATS_MEMORY(memory_)
 	};
 
 	
@@ -219,9 +334,9 @@ namespace Rclusterpp {
 
 	template<class Value>
 		struct ClusterTypes {
-			typedef ClusterWithID            plain;
+			typedef ClusterWithID<Value>     plain;
 			typedef ClusterWithCenter<Value> center;
-			typedef ClusterWithObs           obs;
+			typedef ClusterWithObs<Value>    obs;
 		};
 	
 
@@ -0,0 +1,171 @@
+#ifndef RCLUSTERPP_CONDENSED_H
+#define RCLUSTERPP_CONDENSED_H
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include <Rclusterpp/util.h>
+
+namespace Rclusterpp {
+
+	// Strictly lower portion of a symmetric N x N matrix stored in the packed column-major
+	// ordering used by R "dist" objects, i.e., (1,0), (2,0), ... (N-1,0), (2,1), ... Provides
+	// the subset of the Eigen matrix interface used by the stored distance linkage methods. 
+	// Only coefficients (i, j) with i > j are addressable.
+	template<class Scalar_>
+	class CondensedMatrix {
+		public:
+			typedef Scalar_ Scalar;
+
+			// Allocate (zero-initialized) storage for the matrix
+			CondensedMatrix(size_t n) : n_(n), owned_(packed_size(n)), data_(owned_.data()) { 
+				RCLUSTERPP_STATS_ALLOCATED(memory_, owned_.size() * sizeof(Scalar)); 
+			}
+
+			// Use existing storage, which will be modified in place (e.g. by Lance-Williams updates)
+			CondensedMatrix(size_t n, Scalar* data) : n_(n), data_(data) {}
+
+			static size_t packed_size(size_t n) { return (n > 1) ? (n * (n - 1)) / 2 : 0; }
+
+			ssize_t rows() const { return n_; }
+			ssize_t cols() const { return n_; }
+			size_t size() const { return packed_size(n_); }
+
+			Scalar* data() { return data_; }
+			const Scalar* data() const { return data_; }
+
+			size_t offset(size_t i, size_t j) const { return (j * (2 * n_ - j - 1)) / 2 + (i - j - 1); }
+
+			Scalar coeff(size_t i, size_t j) const { return data_[offset(i, j)]; }
+			Scalar& coeffRef(size_t i, size_t j) { return data_[offset(i, j)]; }
+
+		private:
+			CondensedMatrix(const CondensedMatrix&);
+			CondensedMatrix& operator=(const CondensedMatrix&);
+
+			size_t              n_;
+			std::vector<Scalar> owned_;
+			Scalar*             data_;
+			RCLUSTERPP_STATS_MEMORY(memory_)
+	};
+
+	// Strictly lower portion of a symmetric N x N matrix stored as the lower triangle of square tiles. Tile
+	// rows are stored consecutively, with each tile stored in row-major order. Unlike the packed dist 
+	// ordering, in which rows are strided, both rows and columns of the matrix occupy a small number 
+	// of contiguous segments. This is much more favorable for I/O when stored out-of-core, e.g., in a 
+	// Util::MappedFile.
+	template<class Scalar_>
+	class TiledCondensedMatrix {
+		public:
+			typedef Scalar_ Scalar;
+
+			enum { TileSize = (sizeof(Scalar) > 4) ? 16 : 32 };  // 2-4 KB tiles
+
+			// Allocate (zero-initialized) storage for the matrix
+			TiledCondensedMatrix(size_t n) : n_(n), owned_(packed_size(n)), data_(owned_.data()) {
+				RCLUSTERPP_STATS_ALLOCATED(memory_, owned_.size() * sizeof(Scalar)); 
+			}
+
+			// Use existing storage of at least packed_size(n) elements 
+			TiledCondensedMatrix(size_t n, Scalar* data) : n_(n), data_(data) {}
+
+			static size_t packed_size(size_t n) { 
+				size_t t = (n + TileSize - 1) / TileSize;
+				return ((t * (t + 1)) / 2) * (TileSize * TileSize); 
+			}
+
+			ssize_t rows() const { return n_; }
+			ssize_t cols() const { return n_; }
+			size_t size() const { return packed_size(n_); }
+
+			Scalar* data() { return data_; }
+			const Scalar* data() const { return data_; }
+
+			size_t offset(size_t i, size_t j) const { 
+				size_t ti = i / TileSize, tj = j / TileSize;
+				return (((ti * (ti + 1)) / 2) + tj) * (TileSize * TileSize) + (i % TileSize) * TileSize + (j % TileSize); 
+			}
+
+			Scalar coeff(size_t i, size_t j) const { return data_[offset(i, j)]; }
+			Scalar& coeffRef(size_t i, size_t j) { return data_[offset(i, j)]; }
+
+		private:
+			TiledCondensedMatrix(const TiledCondensedMatrix&);
+			TiledCondensedMatrix& operator=(const TiledCondensedMatrix&);
+
+			size_t              n_;
+			std::vector<Scalar> owned_;
+			Scalar*             data_;
+			RCLUSTERPP_STATS_MEMORY(memory_)
+	};
+
+	// Copy distances in the packed dist ordering into a condensed matrix
+	
+	template<class Iterator, class Matrix>
+	void copy_packed(Iterator first, Matrix& m) {
+		for (ssize_t j=0; j<m.cols(); j++) {
+			for (ssize_t i=j+1; i<m.rows(); i++, ++first) {
+				m.coeffRef(i, j) = *first;
+			}
+		}
+	}
+	
+	template<class Iterator, class Scalar>
+	void copy_packed(Iterator first, CondensedMatrix<Scalar>& m) {
+		std::copy(first, first + m.size(), m.data());
+	}
+
+	// Number of rows in each tile of distances such that the data rows for a pair of tiles (with cols values
+	// of the given size in bytes) fit in a typical L2 cache
+	inline size_t distance_tile_size(size_t cols, size_t bytes) {
+		return std::max<size_t>(32, std::min<size_t>(256, (256 * 1024) / (2 * std::max<size_t>(cols, 1) * bytes)));
+	}
+
+	// Fill a condensed matrix with the distances between the rows of the data, as computed by the distancer
+	// (see Methods::DistanceFromStoredDataRows). The distances are computed in parallel over square tiles of
+	// rows and columns, so that the corresponding data rows remain in cache and distancers can compute an
+	// entire tile at once, e.g., with a matrix product. The distances are converted to the matrix Scalar.
+	template<class Distancer, class Matrix>
+	void condensed_distances(const Distancer& distancer, Matrix& m, size_t tile, const ExecutionContext& context=ExecutionContext()) {
+		typedef typename Distancer::result_type                                                 distance_type;
+		typedef Eigen::Matrix<distance_type, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> block_type;
+
+		const ssize_t n = m.rows(), t = (n + tile - 1) / tile, tiles = (t * (t + 1)) / 2;
+
+#ifdef _OPENMP
+		#pragma omp parallel num_threads(context.threads())
+#endif
+		{
+			block_type block(tile, tile);
+#ifdef _OPENMP
+			#pragma omp for schedule(dynamic)
+#endif
+			for (ssize_t k=0; k<tiles; k++) {
+				// Tiles (ti, tj), with tj <= ti, are numbered k = ti * (ti + 1) / 2 + tj
+				ssize_t ti = (ssize_t)((std::sqrt(8. * k + 1.) - 1.) / 2.);
+				while ((ti * (ti + 1)) / 2 > k)
+					ti--;
+				while (((ti + 1) * (ti + 2)) / 2 <= k)
+					ti++;
+				ssize_t tj = k - (ti * (ti + 1)) / 2;
+				
+				ssize_t i = ti * tile, j = tj * tile, ni = std::min<ssize_t>(tile, n - i), nj = std::min<ssize_t>(tile, n - j);
+				distancer.block(i, ni, j, nj, block);
+				
+				// Store by column, which is contiguous in the packed dist ordering
+				for (ssize_t c=0; c<nj; c++) {
+					for (ssize_t r=(ti == tj) ? c + 1 : 0; r<ni; r++) {
+						m.coeffRef(i + r, j + c) = block(r, c);
+					}
+				}
+			}
+		}
+	}
+
+	typedef CondensedMatrix<double> CondensedNumericMatrix;
+	typedef CondensedMatrix<float>  CondensedFloatMatrix;
+
+} // end of Rclusterpp namespace
+
+#endif
@@ -3,14 +3,15 @@
 
 namespace Rclusterpp {
 
-	typedef ClusterTypes<Rcpp::NumericMatrix::stored_type> NumericCluster;	
+	typedef ClusterTypes<double> NumericCluster;	
+	typedef ClusterTypes<float>  FloatCluster;
 
 	// Initialization and destruction
 
 	template<class Matrix, class Clusters>
 	Clusters& init_clusters(const Matrix& matrix, Clusters& clusters) {
 		for (ssize_t i=0; i<matrix.rows(); i++) {
-			clusters[i] = Clusters::make_cluster(-(i+1), i);
+			clusters[i] = clusters.make_cluster(-(i+1), i);
 		}
 		return clusters;
 	}
@@ -18,13 +19,26 @@ namespace Rclusterpp {
 	template<class Matrix, class Clusters>
 	Clusters& init_clusters_from_rows(const Matrix& matrix, Clusters& clusters) {
 		for (ssize_t i=0; i<matrix.rows(); i++) {
-			clusters[i] = Clusters::make_cluster(-(i+1), i, matrix.row(i));
+			clusters[i] = clusters.make_cluster(-(i+1), i, matrix.row(i));
+		}
+		return clusters;
+	}
+
+	// Weight the initial clusters, e.g., by the number of observations aggregated into each. Clusters are
+	// left unweighted if no weights are provided.
+	template<class Vector, class Clusters>
+	Clusters& init_weights(const Vector& weights, Clusters& clusters) {
+		if (weights.size() == 0)
+			return clusters;
+		for (size_t i=0; i<clusters.initial_clusters(); i++) {
+			clusters[i]->set_weight(weights[i]);
 		}
 		return clusters;
 	}
 
 	// Translate clustering results to format expected by R...
 	
+#ifndef RCLUSTERPP_NATIVE
 	class Hclust {
 		public:
 		
@@ -40,9 +54,25 @@ namespace Rclusterpp {
 			Hclust();
 			explicit Hclust(const Hclust&);
 	};
+#endif
+
+	// Clustering results with the same layout as Hclust, but in native storage, so that they can be populated 
+	// without using R, e.g., by concurrent clusterings in a batch
+	class NativeHclust {
+		public:
+
+			Eigen::MatrixXi     merge;
+			std::vector<double> height;
+			std::vector<int>    order;
+
+			NativeHclust(size_t num_obs) : merge(num_obs-1, 2), height(num_obs-1), order(num_obs) {}
+
+			size_t agglomerations() const { return merge.rows(); }
+	};
 		
-	template<class Clusters>
-	void populate_Rhclust(const Clusters& clusters, Hclust& hclust) {
+	template<class Clusters, class Result>
+	void populate_Rhclust(const Clusters& clusters, Result& hclust) {
+		RCLUSTERPP_STATS_TIME(POPULATE_TIME);
 	
 		if (clusters.size() != (2 * hclust.agglomerations() + 1)) {
 			std::invalid_argument("Rclusterpp clusters and hclust object inconsistently sized");
@@ -52,12 +82,15 @@ namespace Rclusterpp {
 		typename Clusters::const_iterator last  = clusters.end();
 		typename Clusters::const_iterator first = last - hclust.agglomerations();
 
-		std::transform(first, last, hclust.merge.column(0).begin(), std::mem_fn(&cluster_type::parent1Id));
-		std::transform(first, last, hclust.merge.column(1).begin(), std::mem_fn(&cluster_type::parent2Id));
-		std::transform(first, last, hclust.height.begin(), std::mem_fn(&cluster_type::disimilarity));
+		for (size_t i=0; i<hclust.agglomerations(); i++) {
+			cluster_type const* c = *(first + i);
+			hclust.merge(i, 0) = c->parent1Id();
+			hclust.merge(i, 1) = c->parent2Id();
+			hclust.height[i]   = c->disimilarity();  // Widens single precision heights
+		}
 
 		// Swap merge entries if needed to match 'stock' hclust output
-		for (int i=0; i<hclust.merge.rows(); i++) {
+		for (size_t i=0; i<hclust.agglomerations(); i++) {
 			int iia = std::max(hclust.merge(i, 0), hclust.merge(i, 1)), iib = std::min(hclust.merge(i, 0), hclust.merge(i, 1));
 			if (iia > 0 || iib > 0)
 				std::swap(iia, iib);
@@ -97,10 +130,12 @@ namespace Rclusterpp {
 
 } // end of Rclusterpp namespace
 
+#ifndef RCLUSTERPP_NATIVE
+
 namespace Rcpp {
 	//template <> SEXP wrap( const Rclusterpp::Hclust& hclust );
 
-	template <typename T> SEXP wrap( const Rclusterpp::ClusterVector<T>& clusters ) {
+	template <typename T, typename S> SEXP wrap( const Rclusterpp::ClusterVector<T,S>& clusters ) {
 		Rclusterpp::Hclust hclust(clusters.initial_clusters());
 		Rclusterpp::populate_Rhclust(clusters, hclust);
 		return Rcpp::wrap(hclust);
@@ -110,6 +145,10 @@ namespace Rcpp {
   	return Eigen::RowMajorNumericMatrix(as<Eigen::MapNumericMatrix>(x));
 	}
 
+	template <> Eigen::RowMajorFloatMatrix as(SEXP x) {
+		return Eigen::RowMajorFloatMatrix(as<Eigen::MapNumericMatrix>(x).cast<float>());
+	}
+
 	template <> Rclusterpp::LinkageKinds as(SEXP x){
 		switch (as<int>(x)) {
 			default: throw not_compatible("Linkage method invalid or not yet supported"); 
@@ -117,6 +156,8 @@ namespace Rcpp {
 			case 2: return Rclusterpp::AVERAGE;
 			case 3: return Rclusterpp::SINGLE;
 			case 4: return Rclusterpp::COMPLETE;
+			case 5: return Rclusterpp::CENTROID;
+			case 6: return Rclusterpp::MEDIAN;
 		}
 	}
 	
@@ -127,13 +168,30 @@ namespace Rcpp {
 			case 2: return Rclusterpp::MANHATTAN;
 			case 3: return Rclusterpp::MAXIMUM;
 			case 4: return Rclusterpp::MINKOWSKI;
+			case 5: return Rclusterpp::SQEUCLIDEAN;
+			case 6: return Rclusterpp::COSINE;
+			case 7: return Rclusterpp::PEARSON;
+		}
+	}
+
+	template <> Rclusterpp::PrecisionKinds as(SEXP x){
+		switch (as<int>(x)) {
+			default: throw not_compatible("Precision invalid or not yet supported"); 
+			case 1: return Rclusterpp::DOUBLE_PRECISION;
+			case 2: return Rclusterpp::SINGLE_PRECISION;
 		}
 	}
 
 	template <> SEXP wrap( const Rclusterpp::Hclust& hclust ) {
 		return List::create( _["merge"] = hclust.merge, _["height"] = hclust.height, _["order"] = hclust.order ); 
 	}
+
+	template <> SEXP wrap( const Rclusterpp::NativeHclust& hclust ) {
+		return List::create( _["merge"] = hclust.merge, _["height"] = hclust.height, _["order"] = hclust.order ); 
+	}
   
 } // Rcpp namespace
 
+#endif // RCLUSTERPP_NATIVE
+
 #endif
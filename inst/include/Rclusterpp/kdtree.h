@@ -0,0 +1,241 @@
+#ifndef RCLUSTERPP_KDTREE_H
+#define RCLUSTERPP_KDTREE_H
+
+#include <limits>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+namespace Rclusterpp {
+
+	namespace Methods {
+
+		// kd-tree over stored cluster centers that accelerates the nearest neighbor searches for Ward's linkage
+		// in low dimensions. The tree structure is determined by the initial centers, while the bounding box of
+		// the centers and the minimum cluster weight within each node are maintained as clusters merge. For a
+		// query cluster of weight q, the Ward's distance to any cluster in a node is bounded below by the squared
+		// distance to the node's box times q * m / (q + m), where m is the minimum cluster weight in the node.
+		// Candidate distances are computed with the linkage's distancer, so the search results are exactly 
+		// those of a scan.
+		//
+		// Implements the neighbor search interface of the cached RNN engine (see ScanNeighbors).
+		template<class Value>
+		class WardsKDTree {
+			public:
+				typedef Value                value_type;
+				typedef StoredCenters<Value> centers_type;
+
+				template<class Clusters>
+				WardsKDTree(const centers_type& centers, const Clusters& clusters, size_t leaf_size=8) : 
+					centers_(centers), dim_(centers.dim()), leaf_size_(std::max<size_t>(leaf_size, 1)), 
+					slots_(clusters.size()), leaf_(clusters.size()), weight_(clusters.size()) {
+					size_t n = clusters.size();
+					for (size_t i=0; i<n; i++) {
+						slots_[i] = i;
+						weight_[clusters[i]->idx()] = clusters[i]->weight();
+					}
+					if (n > 0)
+						build(0, n, -1);
+					RCLUSTERPP_STATS_ALLOCATED(memory_, 
+						nodes_.capacity() * sizeof(Node) + (boxes_.capacity() + weight_.size()) * sizeof(Value) + (slots_.size() + leaf_.size()) * sizeof(size_t));
+				}
+
+				template<class Active, class Cluster, class Distancer, class Neighbors, class Slots>
+				void team_search(Active& active, Cluster* tip, Distancer& distancer, size_t k, Neighbors& neighbors, Slots& slots) {
+#ifdef _OPENMP
+					#pragma omp single
+#endif
+					{
+						RCLUSTERPP_STATS_TIME(NEIGHBOR_TIME);
+
+						typedef typename Distancer::result_type distance_type;
+						typedef std::pair<distance_type, size_t> entry_type;  // Distance and idx of neighbor
+						
+						const Value* q  = centers_.row(tip->idx()).data();
+						Value        qs = tip->weight();
+
+						std::vector<entry_type> nearest;
+						nearest.reserve(k + 1);
+						
+						std::vector<std::pair<Value, size_t> > stack;  // Lower bound and node
+						stack.push_back(std::make_pair(node_bound(0, q, qs), 0));
+						while (!stack.empty()) {
+							Value  lb   = stack.back().first;
+							size_t node = stack.back().second;
+							stack.pop_back();
+							if (nearest.size() == k && lb >= nearest.back().first)
+								continue;
+
+							const Node& n = nodes_[node];
+							if (n.left < 0) {
+								for (size_t i=n.begin; i<n.end; i++) {
+									size_t s = slots_[i];
+									if (weight_[s] == 0 || s == tip->idx())
+										continue;
+									distance_type max_d = (nearest.size() < k) ? std::numeric_limits<distance_type>::max() : nearest.back().first;
+									distance_type dist  = distancer(*tip, *active.at(s), max_d);
+									RCLUSTERPP_STATS_ADD(DISTANCES, 1);
+									if (nearest.size() < k || dist < max_d) {
+										nearest.insert(std::upper_bound(nearest.begin(), nearest.end(), entry_type(dist, s)), entry_type(dist, s));
+										if (nearest.size() > k)
+											nearest.pop_back();
+									}
+								}
+							} else {
+								// Visit the closer child first
+								Value ll = node_bound(n.left, q, qs), rl = node_bound(n.right, q, qs);
+								if (ll < rl) {
+									stack.push_back(std::make_pair(rl, n.right));
+									stack.push_back(std::make_pair(ll, n.left));
+								} else {
+									stack.push_back(std::make_pair(ll, n.left));
+									stack.push_back(std::make_pair(rl, n.right));
+								}
+							}
+						}
+
+						neighbors.clear();
+						for (size_t i=0; i<nearest.size(); i++)
+							neighbors.push_back( std::make_pair(active.at(nearest[i].second), nearest[i].first) );
+					
+						slots.bound = (nearest.size() == k) ? nearest.back().first : std::numeric_limits<distance_type>::max();
+					}
+				}
+
+				// Update the tree after the clusters have been merged (and the centers updated)
+				template<class Cluster>
+				void merge(const Cluster& co) {
+					size_t into = co.idx(), from = std::max(co.parent1()->idx(), co.parent2()->idx());
+					weight_[into] = co.weight();
+					weight_[from] = 0;
+					update(leaf_[into]);
+					update(leaf_[from]);
+				}
+
+			private:
+				
+				struct Node {
+					size_t  begin, end;   // Range of slots
+					ssize_t left, right;  // Children, negative for leaves
+					ssize_t parent;
+					size_t  count;        // Number of active clusters
+					Value   min_weight;   // Minimum weight of the active clusters
+				};
+
+				Value* lower(size_t node) { return &boxes_[node * 2 * dim_]; }
+				Value* upper(size_t node) { return &boxes_[node * 2 * dim_ + dim_]; }
+				const Value* lower(size_t node) const { return &boxes_[node * 2 * dim_]; }
+				const Value* upper(size_t node) const { return &boxes_[node * 2 * dim_ + dim_]; }
+
+				size_t build(size_t begin, size_t end, ssize_t parent) {
+					size_t node = nodes_.size();
+					Node   n    = { begin, end, -1, -1, parent, 0, 0 };
+					nodes_.push_back(n);
+					boxes_.resize(boxes_.size() + 2 * dim_);
+
+					if (end - begin <= leaf_size_) {
+						for (size_t i=begin; i<end; i++)
+							leaf_[slots_[i]] = node;
+					} else {
+						// Split at the median of the dimension with the largest extent
+						refresh(node);
+						size_t split = 0;
+						for (size_t d=1; d<dim_; d++) {
+							if (upper(node)[d] - lower(node)[d] > upper(node)[split] - lower(node)[split])
+								split = d;
+						}
+						size_t mid = begin + (end - begin) / 2;
+						std::nth_element(slots_.begin() + begin, slots_.begin() + mid, slots_.begin() + end, CompareCenters(centers_, split));
+						
+						size_t left = build(begin, mid, node);
+						size_t right = build(mid, end, node);
+						nodes_[node].left  = left;
+						nodes_[node].right = right;
+					}
+					
+					refresh(node);
+					return node;
+				}
+
+				// Recompute node summary from its clusters (leaves) or children
+				void refresh(size_t node) {
+					Node&  n  = nodes_[node];
+					Value* lo = lower(node);
+					Value* hi = upper(node);
+					std::fill(lo, lo + dim_, std::numeric_limits<Value>::max());
+					std::fill(hi, hi + dim_, std::numeric_limits<Value>::lowest());
+					n.count    = 0;
+					n.min_weight = std::numeric_limits<Value>::max();
+
+					if (n.left < 0) {
+						for (size_t i=n.begin; i<n.end; i++) {
+							size_t s = slots_[i];
+							if (weight_[s] == 0)
+								continue;
+							const Value* c = centers_.row(s).data();
+							for (size_t d=0; d<dim_; d++) {
+								lo[d] = std::min(lo[d], c[d]);
+								hi[d] = std::max(hi[d], c[d]);
+							}
+							n.count++;
+							n.min_weight = std::min(n.min_weight, weight_[s]);
+						}
+					} else {
+						const ssize_t children[2] = { n.left, n.right };
+						for (int c=0; c<2; c++) {
+							const Node& cn = nodes_[children[c]];
+							if (cn.count == 0)
+								continue;
+							for (size_t d=0; d<dim_; d++) {
+								lo[d] = std::min(lo[d], lower(children[c])[d]);
+								hi[d] = std::max(hi[d], upper(children[c])[d]);
+							}
+							n.count     += cn.count;
+							n.min_weight = std::min(n.min_weight, cn.min_weight);
+						}
+					}
+				}
+
+				void update(ssize_t node) {
+					for (; node >= 0; node = nodes_[node].parent)
+						refresh(node);
+				}
+
+				Value node_bound(size_t node, const Value* q, Value qs) const {
+					const Node& n = nodes_[node];
+					if (n.count == 0)
+						return std::numeric_limits<Value>::max();
+
+					const Value* lo = lower(node);
+					const Value* hi = upper(node);
+					Value d2 = 0;
+					for (size_t d=0; d<dim_; d++) {
+						Value diff = (q[d] < lo[d]) ? lo[d] - q[d] : ((q[d] > hi[d]) ? q[d] - hi[d] : 0);
+						d2 += diff * diff;
+					}
+					// Slightly loosen the bound to account for the different order of operations in the distancer
+					return d2 * ((qs * n.min_weight) / (qs + n.min_weight)) * (1 - 16 * std::numeric_limits<Value>::epsilon());
+				}
+
+				struct CompareCenters {
+					const centers_type& centers;
+					size_t              dim;
+					CompareCenters(const centers_type& c, size_t d) : centers(c), dim(d) {}
+					bool operator()(size_t a, size_t b) const { return centers.row(a)(dim) < centers.row(b)(dim); }
+				};
+				
+				const centers_type& centers_;
+				size_t              dim_, leaf_size_;
+				std::vector<Node>   nodes_;
+				std::vector<Value>  boxes_;  // Lower and upper corners of each node's box
+				std::vector<size_t> slots_;  // Cluster idxs, ordered by node
+				std::vector<size_t> leaf_;   // Leaf node for each cluster idx
+				std::vector<Value>  weight_; // Weight of the cluster at each idx, zero if no longer active
+				RCLUSTERPP_STATS_MEMORY(memory_)
+		};
+
+	} // end of Methods namespace
+
+} // end of Rclusterpp namespace
+
+#endif
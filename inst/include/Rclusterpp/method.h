@@ -19,6 +19,10 @@ namespace Rclusterpp {
 		typedef Cluster         third_argument_type;
 		typedef Util::IndexList fourth_argument_type;
 		typedef void		  result_type;
+
+		// Team mergers are invoked by every thread in the clustering thread team (and are responsible for 
+		// dividing the work among those threads), all other mergers are invoked by a single thread
+		static const bool team_merge = false;
 	};
 
 
@@ -45,20 +49,139 @@ namespace Rclusterpp {
 			return maxCoeff( Eigen::abs( a - b ) );  // Note abs is ambiguous to use explicit namespace
 		}
 
-		namespace {
-			// TODO: Encapsulate this with function binding instead of using a global variable. Will
-			// require more sophisticated typing for distance functions.
-			double minkowski_power_g = 1.0;
+		template<class V>
+		typename V::RealScalar sqeuclidean_distance(const V& a, const V& b) {
+			using namespace Eigen;
+			return squaredNorm( a - b ); 
 		}
 
 		template<class V>
-		typename V::RealScalar minkowski_distance(const V& a, const V& b) {
+		typename V::RealScalar minkowski_distance(const V& a, const V& b, double p) {
 			using namespace Eigen;
-			return lpNorm( a - b, minkowski_power_g );
+			return lpNorm( a - b, p );
+		}
+
+		// Cosine distance 1 - ab'/(|a||b|), where a zero-length row is at distance 1 from all other rows
+		template<class V>
+		typename V::RealScalar cosine_distance(const V& a, const V& b) {
+			typedef typename V::RealScalar scalar_type;
+			scalar_type norms = a.norm() * b.norm();
+			return (norms > 0) ? std::max<scalar_type>(1 - a.dot(b) / norms, 0) : 1;
+		}
+
+		// Pearson correlation distance, i.e., the cosine distance between the centered rows
+		template<class V>
+		typename V::RealScalar pearson_distance(const V& a, const V& b) {
+			return cosine_distance((a.array() - a.mean()).matrix(), (b.array() - b.mean()).matrix());
 		}
 
+		// Distance functors, one per DistanceKinds. Using these functors directly (instead of via
+		// function pointers) allows the distance computations to be inlined into the linkage loops.
+
+		template<class Scalar>
+		struct EuclideanDistance {
+			typedef Scalar result_type;
+			template<class V>
+			result_type operator()(const V& a, const V& b) const { return euclidean_distance(a, b); }
+		};
+
+		template<class Scalar>
+		struct ManhattanDistance {
+			typedef Scalar result_type;
+			template<class V>
+			result_type operator()(const V& a, const V& b) const { return manhattan_distance(a, b); }
+		};
+
+		template<class Scalar>
+		struct MaximumDistance {
+			typedef Scalar result_type;
+			template<class V>
+			result_type operator()(const V& a, const V& b) const { return maximum_distance(a, b); }
+		};
+
+		template<class Scalar>
+		struct SquaredEuclideanDistance {
+			typedef Scalar result_type;
+			template<class V>
+			result_type operator()(const V& a, const V& b) const { return sqeuclidean_distance(a, b); }
+		};
+
+		template<class Scalar>
+		struct CosineDistance {
+			typedef Scalar result_type;
+			template<class V>
+			result_type operator()(const V& a, const V& b) const { return cosine_distance(a, b); }
+		};
+
+		template<class Scalar>
+		struct PearsonDistance {
+			typedef Scalar result_type;
+			template<class V>
+			result_type operator()(const V& a, const V& b) const { return pearson_distance(a, b); }
+		};
+
+		template<class Scalar>
+		class MinkowskiDistance {
+			public:
+				typedef Scalar result_type;
+				
+				MinkowskiDistance(double p) : p_(p) {}
+				
+				template<class V>
+				result_type operator()(const V& a, const V& b) const { return minkowski_distance(a, b, p_); }
+			
+			private:
+				double p_;
+		};
+
+
+		// Reductions over the (weighted) distances between all pairs of observations in two clusters, either
+		// one pair at a time or over a block of distances (with vectors of weights for the rows and columns) 
+
+		struct WeightedSumReduce {
+			template<class T>
+			static T init() { return 0.; }
+			template<class T>
+			static T combine(T result, T weight, T distance) { return result + weight * distance; }
+			template<class T, class W, class D>
+			static T combine(T result, const W& w1, const W& w2, const D& distances) { return result + w1.dot(distances * w2); }
+		};
+
+		struct MaximumReduce {
+			template<class T>
+			static T init() { return std::numeric_limits<T>::min(); }
+			template<class T>
+			static T combine(T result, T weight, T distance) { return std::max(result, distance); }
+			template<class T, class W, class D>
+			static T combine(T result, const W& w1, const W& w2, const D& distances) { return std::max(result, distances.maxCoeff()); }
+		};
+
+		// Reduce the distances between all pairs of observations one pair at a time, returning early (with
+		// the maximum value) if the result exceeds the threshold m
+		template<class Reduce, class Distancer, class Cluster>
+		typename Distancer::result_type pairwise_reduce(const Distancer& d, const Cluster& c1, const Cluster& c2, typename Distancer::result_type m) {
+			typedef typename Distancer::result_type result_type;
+			typedef typename Cluster::idx_const_iterator iter;
+
+			result_type result = Reduce::template init<result_type>();
+			for (iter i=c1.idxs_begin(), ie=c1.idxs_end(); i!=ie; ++i) {
+				result_type wi = i.weight();
+				for (iter j=c2.idxs_begin(), je=c2.idxs_end(); j!=je; ++j) {
+					result = Reduce::combine(result, wi * j.weight(), d(*i, *j));
+					if (result > m) {
+						return std::numeric_limits<result_type>::max();  // Return early if exceed threshold
+					}
+				}
+			}
+			return result;
+		}
 
 		// Distance Adaptors
+		//
+		// Distancers compute distances between observations (rows of the data) by index. In addition to
+		// individual pairs, distancers compute the distances from one row to a contiguous range of rows, 
+		// blocks of distances between two ranges of rows and reductions over all pairs of observations in 
+		// two clusters.
 		
 		template<class Matrix, class Distance>
 		class DistanceFromStoredDataRows {
@@ -71,6 +194,32 @@ namespace Rclusterpp {
 					return distance_(data_.row(i1), data_.row(i2));
 				}
 
+				// Distances from row i to rows [first, first+n)
+				void distances(size_t i, size_t first, size_t n, result_type* out) const {
+					for (size_t j=0; j<n; j++)
+						out[j] = distance_(data_.row(i), data_.row(first + j));
+				}
+
+				// Distances from row i to the n rows in idxs
+				void distances(size_t i, const size_t* idxs, size_t n, result_type* out) const {
+					for (size_t j=0; j<n; j++)
+						out[j] = distance_(data_.row(i), data_.row(idxs[j]));
+				}
+
+				// Distances between rows [i, i+ni) and rows [j, j+nj), as an ni x nj block
+				template<class Block>
+				void block(size_t i, size_t ni, size_t j, size_t nj, Block& out) const {
+					out.resize(ni, nj);
+					for (size_t r=0; r<ni; r++)
+						for (size_t c=0; c<nj; c++)
+							out(r, c) = distance_(data_.row(i + r), data_.row(j + c));
+				}
+
+				template<class Reduce, class Cluster>
+				result_type reduce_pairs(const Cluster& c1, const Cluster& c2, result_type m) const {
+					return pairwise_reduce<Reduce>(*this, c1, c2, m);
+				}
+
 			private:	
 				DistanceFromStoredDataRows() {}
 
@@ -78,6 +227,259 @@ namespace Rclusterpp {
 				Distance distance_;
 		};
 
+		// Euclidean (or squared Euclidean) distances between the rows of the data, computed in blocks as 
+		// ||a||^2 + ||b||^2 - 2ab' from precomputed row norms and matrix products, i.e., with level-2 and
+		// level-3 BLAS operations instead of one pair at a time. Distances that are small relative to the
+		// norms, and thus subject to cancellation, are recomputed directly. 
+		template<class Matrix, bool Squared=false>
+		class EuclideanBlocks {
+			public:
+				typedef typename Matrix::Scalar                                                     result_type;
+				typedef Eigen::Matrix<result_type, Eigen::Dynamic, 1>                               norms_type;
+				typedef Eigen::Matrix<result_type, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> block_type;
+
+				EuclideanBlocks(const Matrix& data) : 
+					data_(data), norms_(data.rowwise().squaredNorm()), tolerance_(std::cbrt(std::numeric_limits<result_type>::epsilon())) {}
+
+				result_type operator()(size_t i1, size_t i2) const {
+					result_type d2 = (data_.row(i1) - data_.row(i2)).squaredNorm();
+					return Squared ? d2 : std::sqrt(d2);
+				}
+
+				// Distances from row i to rows [first, first+n)
+				void distances(size_t i, size_t first, size_t n, result_type* out) const {
+					Eigen::Map<block_type> products(out, n, 1);
+					products.noalias() = data_.middleRows(first, n) * data_.row(i).transpose();
+					finish(data_.middleRows(first, n), data_.row(i), norms_.segment(first, n), norms_.segment(i, 1), products);
+				}
+
+				// Distances from row i to the n rows in idxs, from the precomputed norms and the inner products
+				void distances(size_t i, const size_t* idxs, size_t n, result_type* out) const {
+					for (size_t j=0; j<n; j++) {
+						result_type nj = norms_[idxs[j]], d2 = norms_[i] + nj - 2 * data_.row(idxs[j]).dot(data_.row(i));
+						if (d2 < tolerance_ * (norms_[i] + nj))
+							d2 = (data_.row(i) - data_.row(idxs[j])).squaredNorm();  // Subject to cancellation
+						out[j] = Squared ? d2 : std::sqrt(d2);
+					}
+				}
+
+				// Distances between rows [i, i+ni) and rows [j, j+nj), as an ni x nj block
+				void block(size_t i, size_t ni, size_t j, size_t nj, block_type& out) const {
+					out.noalias() = data_.middleRows(i, ni) * data_.middleRows(j, nj).transpose();
+					finish(data_.middleRows(i, ni), data_.middleRows(j, nj), norms_.segment(i, ni), norms_.segment(j, nj), out);
+				}
+
+				// Reductions over pairs of larger clusters gather the observations into tiles of rows and compute
+				// the distances between tiles with matrix products. The threshold is checked after every tile. 
+				// Smaller clusters (where the gathering dominates) are reduced one pair at a time.
+				template<class Reduce, class Cluster>
+				result_type reduce_pairs(const Cluster& c1, const Cluster& c2, result_type m) const {
+					if (std::min(c1.size(), c2.size()) < 8)
+						return pairwise_reduce<Reduce>(*this, c1, c2, m);
+
+					const size_t n1 = c1.size(), n2 = c2.size(), ta = std::min<size_t>(64, n1), tb = std::min<size_t>(256, n2);
+					
+					block_type a(ta, data_.cols()), b(tb, data_.cols()), products(ta, tb);
+					norms_type na(ta), nb(tb), w1(n1), w2(n2);
+					std::vector<size_t> i1(n1), i2(n2);
+					gather(c1, i1, w1);
+					gather(c2, i2, w2);
+					
+					result_type result = Reduce::template init<result_type>();
+					for (size_t j=0; j<n2; j+=tb) {
+						size_t nj = std::min(tb, n2 - j);
+						for (size_t c=0; c<nj; c++) {
+							b.row(c) = data_.row(i2[j + c]);
+							nb[c]    = norms_[i2[j + c]];
+						}
+						
+						for (size_t i=0; i<n1; i+=ta) {
+							size_t ni = std::min(ta, n1 - i);
+							for (size_t r=0; r<ni; r++) {
+								a.row(r) = data_.row(i1[i + r]);
+								na[r]    = norms_[i1[i + r]];
+							}
+							
+							products.topLeftCorner(ni, nj).noalias() = a.topRows(ni) * b.topRows(nj).transpose();
+							finish(a.topRows(ni), b.topRows(nj), na.head(ni), nb.head(nj), products.topLeftCorner(ni, nj));
+							
+							result = Reduce::combine(result, w1.segment(i, ni), w2.segment(j, nj), products.topLeftCorner(ni, nj));
+							if (result > m) {
+								return std::numeric_limits<result_type>::max();  // Return early if exceed threshold
+							}
+						}
+					}
+					return result;
+				}
+
+			private:
+				// Convert the inner products between the rows of a and b, with squared norms na and nb, to distances
+				template<class A, class B, class NA, class NB>
+				void finish(const A& a, const B& b, const NA& na, const NB& nb, Eigen::Ref<block_type> products) const {
+					products = ((-2 * products).colwise() + na).rowwise() + nb.transpose();
+					if (products.minCoeff() < tolerance_ * (na.maxCoeff() + nb.maxCoeff())) {
+						for (ssize_t r=0; r<products.rows(); r++) {
+							for (ssize_t c=0; c<products.cols(); c++) {
+								if (products(r, c) < tolerance_ * (na[r] + nb[c]))
+									products(r, c) = (a.row(r) - b.row(c)).squaredNorm();
+							}
+						}
+					}
+					if (!Squared)
+						products = products.cwiseSqrt();
+				}
+
+				template<class Cluster>
+				static void gather(const Cluster& c, std::vector<size_t>& idxs, norms_type& weights) {
+					typedef typename Cluster::idx_const_iterator iter;
+					size_t k = 0;
+					for (iter i=c.idxs_begin(), ie=c.idxs_end(); i!=ie; ++i, ++k) {
+						idxs[k]    = *i;
+						weights[k] = i.weight();
+					}
+				}
+
+				const Matrix& data_;
+				norms_type    norms_;
+				result_type   tolerance_;
+		};
+
+		// Center (if centered) and scale the rows of m, in place, to unit length. The cosine (or, if centered, the
+		// Pearson correlation) distance between two rows is then simply 1 - ab'. Zero-length rows are unchanged.
+		template<class Matrix>
+		void normalize_rows(Matrix& m, bool centered) {
+			typedef Eigen::Matrix<typename Matrix::Scalar, Eigen::Dynamic, 1> vector_type;
+
+			if (centered) {
+				vector_type means(m.rowwise().mean());
+				m.colwise() -= means;
+			}
+			vector_type norms(m.rowwise().norm());
+			for (ssize_t r=0; r<m.rows(); r++) {
+				if (norms[r] > 0)
+					m.row(r) /= norms[r];
+			}
+		}
+
+		// Cosine (or Pearson correlation) distances 1 - ab' between rows normalized with normalize_rows, so
+		// that each distance is a single inner product and the distances to a range of rows, or between blocks
+		// of rows, are matrix products.
+		template<class Matrix>
+		class NormalizedBlocks {
+			public:
+				typedef typename Matrix::Scalar                                                     result_type;
+				typedef Eigen::Matrix<result_type, Eigen::Dynamic, 1>                               weights_type;
+				typedef Eigen::Matrix<result_type, 1, Eigen::Dynamic>                               row_type;
+				typedef Eigen::Matrix<result_type, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> block_type;
+
+				NormalizedBlocks(const Matrix& data) : data_(data) {}
+
+				result_type operator()(size_t i1, size_t i2) const {
+					return std::max<result_type>(1 - data_.row(i1).dot(data_.row(i2)), 0);
+				}
+
+				// Distances from row i to rows [first, first+n)
+				void distances(size_t i, size_t first, size_t n, result_type* out) const {
+					Eigen::Map<block_type> products(out, n, 1);
+					products.noalias() = data_.middleRows(first, n) * data_.row(i).transpose();
+					finish(products);
+				}
+
+				// Distances from row i to the n rows in idxs
+				void distances(size_t i, const size_t* idxs, size_t n, result_type* out) const {
+					for (size_t j=0; j<n; j++)
+						out[j] = (*this)(i, idxs[j]);
+				}
+
+				// Distances between rows [i, i+ni) and rows [j, j+nj), as an ni x nj block
+				void block(size_t i, size_t ni, size_t j, size_t nj, block_type& out) const {
+					out.noalias() = data_.middleRows(i, ni) * data_.middleRows(j, nj).transpose();
+					finish(out);
+				}
+
+				template<class Reduce, class Cluster>
+				result_type reduce_pairs(const Cluster& c1, const Cluster& c2, result_type m) const {
+					if (std::min(c1.size(), c2.size()) < 2)
+						return pairwise_reduce<Reduce>(*this, c1, c2, m);
+					return reduce(Reduce(), c1, c2, m);
+				}
+
+			private:
+				// The weighted sum of the distances between all pairs of observations in two clusters is 
+				// W1 W2 - (sum_i w_i a_i)(sum_j w_j b_j)', i.e., a single inner product between the weighted sums
+				// of the rows of each cluster
+				template<class Cluster>
+				result_type reduce(WeightedSumReduce, const Cluster& c1, const Cluster& c2, result_type m) const {
+					result_type w1, w2;
+					row_type    s1(weighted_sum(c1, w1)), s2(weighted_sum(c2, w2));
+					return std::max<result_type>(w1 * w2 - s1.dot(s2), 0);
+				}
+
+				// Other reductions compute the distances between tiles of the gathered observations with matrix
+				// products, checking the threshold after every tile
+				template<class Reduce, class Cluster>
+				result_type reduce(Reduce, const Cluster& c1, const Cluster& c2, result_type m) const {
+					typedef typename Cluster::idx_const_iterator iter;
+					
+					const size_t n1 = c1.size(), n2 = c2.size(), ta = std::min<size_t>(64, n1), tb = std::min<size_t>(256, n2);
+
+					block_type   a(ta, data_.cols()), b(tb, data_.cols()), products(ta, tb);
+					weights_type w1(n1), w2(n2);
+					std::vector<size_t> i1, i2;
+					i1.reserve(n1);
+					i2.reserve(n2);
+					for (iter i=c1.idxs_begin(), ie=c1.idxs_end(); i!=ie; ++i) {
+						w1[i1.size()] = i.weight();
+						i1.push_back(*i);
+					}
+					for (iter i=c2.idxs_begin(), ie=c2.idxs_end(); i!=ie; ++i) {
+						w2[i2.size()] = i.weight();
+						i2.push_back(*i);
+					}
+
+					result_type result = Reduce::template init<result_type>();
+					for (size_t j=0; j<n2; j+=tb) {
+						size_t nj = std::min(tb, n2 - j);
+						for (size_t c=0; c<nj; c++)
+							b.row(c) = data_.row(i2[j + c]);
+						
+						for (size_t i=0; i<n1; i+=ta) {
+							size_t ni = std::min(ta, n1 - i);
+							for (size_t r=0; r<ni; r++)
+								a.row(r) = data_.row(i1[i + r]);
+							
+							products.topLeftCorner(ni, nj).noalias() = a.topRows(ni) * b.topRows(nj).transpose();
+							finish(products.topLeftCorner(ni, nj));
+							
+							result = Reduce::combine(result, w1.segment(i, ni), w2.segment(j, nj), products.topLeftCorner(ni, nj));
+							if (result > m) {
+								return std::numeric_limits<result_type>::max();  // Return early if exceed threshold
+							}
+						}
+					}
+					return result;
+				}
+
+				// Convert the inner products to distances (clamping any negative distances from rounding)
+				static void finish(Eigen::Ref<block_type> products) {
+					products = (1 - products.array()).cwiseMax(0);
+				}
+
+				template<class Cluster>
+				row_type weighted_sum(const Cluster& c, result_type& weight) const {
+					typedef typename Cluster::idx_const_iterator iter;
+					row_type sum(row_type::Zero(data_.cols()));
+					weight = 0;
+					for (iter i=c.idxs_begin(), ie=c.idxs_end(); i!=ie; ++i) {
+						sum    += i.weight() * data_.row(*i);
+						weight += i.weight();
+					}
+					return sum;
+				}
+
+				const Matrix& data_;
+		};
+
 		// Link Adaptors
 		
 		template<class Cluster, class Distance>
@@ -89,20 +491,16 @@ namespace Rclusterpp {
 			
 				result_type operator()(const Cluster& c1, const Cluster& c2, result_type m=std::numeric_limits<result_type>::max()) const {
 					if (m < std::numeric_limits<result_type>::max()) {
-						m *= (c1.size() * c2.size());  // Adjust threshold to account for averaging denominator
+						m *= (c1.weight() * c2.weight());  // Adjust threshold to account for averaging denominator
 					}
 					
-					result_type result = 0.;
-					typedef typename Cluster::idx_const_iterator iter;
-					for (iter i=c1.idxs_begin(), ie=c1.idxs_end(); i!=ie; ++i) {
-						for (iter j=c2.idxs_begin(), je=c2.idxs_end(); j!=je; ++j) {
-							result += d_(*i, *j);
-							if (result > m) {
-								return std::numeric_limits<result_type>::max();  // Return early if exceed threshold
-							}
-						}
+					// Weighted average over all pairs of observations
+					result_type result = d_.template reduce_pairs<WeightedSumReduce>(c1, c2, m);
+					if (result == std::numeric_limits<result_type>::max()) {
+						RCLUSTERPP_STATS_ADD(EARLY_EXITS, 1);
+						return result;
 					}
-					return result / (c1.size() * c2.size());
+					return result / (c1.weight() * c2.weight());
 				}
 
 			private:
@@ -117,16 +515,9 @@ namespace Rclusterpp {
 				CompleteLink(Distance d) : d_(d) {}
 			
 				result_type operator()(const Cluster& c1, const Cluster& c2, result_type m=std::numeric_limits<result_type>::max()) const {
-					result_type result = std::numeric_limits<result_type>::min();
-					typedef typename Cluster::idx_const_iterator iter;
-					for (iter i=c1.idxs_begin(), ie=c1.idxs_end(); i!=ie; ++i) {
-						for (iter j=c2.idxs_begin(), je=c2.idxs_end(); j!=je; ++j) {
-							result = std::max(result, d_(*i, *j));
-							if (result > m) {
-								return std::numeric_limits<result_type>::max();  // Return early if exceed threshold
-							}
-						}
-					}
+					result_type result = d_.template reduce_pairs<MaximumReduce>(c1, c2, m);
+					if (result == std::numeric_limits<result_type>::max())
+						RCLUSTERPP_STATS_ADD(EARLY_EXITS, 1);
 					return result;
 				}
 
@@ -140,10 +531,121 @@ namespace Rclusterpp {
 			typedef typename Cluster::distance_type result_type;		
 			result_type operator()(const Cluster& c1, const Cluster& c2, result_type d=0.) const {
 				using namespace Eigen;
-				return squaredNorm( c1.center() - c2.center() ) * (c1.size() * c2.size()) / (c1.size() + c2.size()); 
+				return squaredNorm( c1.center() - c2.center() ) * (c1.weight() * c2.weight()) / (c1.weight() + c2.weight()); 
 			}
 		};
 
+		// Center matrix
+
+		// Cluster centers stored contiguously, one row per cluster idx. Rows are padded with zeros
+		// so that every row is aligned for vectorized distance computations.
+		template<class Value>
+		class StoredCenters {
+			public:
+				typedef Value                                                             value_type;
+				typedef Eigen::Matrix<Value, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> matrix_type;
+
+				enum { 
+					RowAlignment = (EIGEN_MAX_ALIGN_BYTES > 0) ? Eigen::AlignedMax : Eigen::Unaligned,
+					RowPadding   = (EIGEN_MAX_ALIGN_BYTES > (int)sizeof(Value)) ? EIGEN_MAX_ALIGN_BYTES / sizeof(Value) : 1
+				};
+				
+				typedef Eigen::Map<Eigen::Array<Value, 1, Eigen::Dynamic>, RowAlignment>       row_type;
+				typedef Eigen::Map<const Eigen::Array<Value, 1, Eigen::Dynamic>, RowAlignment> const_row_type;
+
+				template<class Matrix>
+				StoredCenters(const Matrix& data) : 
+					dim_(data.cols()), centers_(matrix_type::Zero(data.rows(), ((data.cols() + RowPadding - 1) / RowPadding) * RowPadding)) {
+					// Data is commonly column-major, so transpose in tiles of rows that fit in cache
+					const ssize_t tile = 256;
+					for (ssize_t r=0; r<data.rows(); r+=tile) {
+						ssize_t n = std::min(tile, (ssize_t)data.rows() - r);
+						centers_.block(r, 0, n, dim_) = data.middleRows(r, n).template cast<Value>();
+					}
+					RCLUSTERPP_STATS_ALLOCATED(memory_, centers_.size() * sizeof(Value));
+				}
+
+				size_t dim() const { return dim_; }
+
+				row_type row(size_t idx) { return row_type(centers_.data() + idx * centers_.cols(), centers_.cols()); }
+				const_row_type row(size_t idx) const { return const_row_type(centers_.data() + idx * centers_.cols(), centers_.cols()); }
+
+			private:
+				size_t      dim_;
+				matrix_type centers_;
+				RCLUSTERPP_STATS_MEMORY(memory_)
+		};
+
+		// Cluster centers and the (weighted) mean squared deviations of the observations from those centers,
+		// stored by cluster idx. Together these determine the average squared Euclidean distance between the
+		// observations of two clusters.
+		template<class Value>
+		class StoredMoments {
+			public:
+				typedef Value                value_type;
+				typedef StoredCenters<Value> centers_type;
+
+				template<class Matrix>
+				StoredMoments(const Matrix& data) : centers(data), variances(data.rows(), 0) {
+					RCLUSTERPP_STATS_ALLOCATED(memory_, variances.size() * sizeof(value_type));
+				}
+
+				centers_type            centers;
+				std::vector<value_type> variances;
+
+			private:
+				RCLUSTERPP_STATS_MEMORY(memory_)
+		};
+
+		template<class Cluster, class Centers>
+		class StoredCentersWardsLink : public DistanceFunctor<Cluster> {
+			public:
+				typedef typename StoredCentersWardsLink::result_type result_type;
+
+				StoredCentersWardsLink(const Centers& c) : centers(c) {}
+
+				result_type operator()(const Cluster& c1, const Cluster& c2, result_type d=0.) const {
+					return (centers.row(c1.idx()) - centers.row(c2.idx())).square().sum() * (c1.weight() * c2.weight()) / (c1.weight() + c2.weight());
+				}
+
+			private:
+				const Centers& centers;
+		};
+
+		// Squared Euclidean distance between centers, as used by the centroid and median linkages
+		template<class Cluster, class Centers>
+		class StoredCentersCentroidLink : public DistanceFunctor<Cluster> {
+			public:
+				typedef typename StoredCentersCentroidLink::result_type result_type;
+
+				StoredCentersCentroidLink(const Centers& c) : centers(c) {}
+
+				result_type operator()(const Cluster& c1, const Cluster& c2, result_type d=0.) const {
+					return (centers.row(c1.idx()) - centers.row(c2.idx())).square().sum();
+				}
+
+			private:
+				const Centers& centers;
+		};
+
+		// Average squared Euclidean distance between the observations of two clusters, which is the squared 
+		// distance between the centers plus the mean squared deviations within each cluster, computed in O(d) 
+		template<class Cluster, class Moments>
+		class AverageSquaredLink : public DistanceFunctor<Cluster> {
+			public:
+				typedef typename AverageSquaredLink::result_type result_type;
+
+				AverageSquaredLink(const Moments& m) : moments(m) {}
+
+				result_type operator()(const Cluster& c1, const Cluster& c2, result_type d=0.) const {
+					return (moments.centers.row(c1.idx()) - moments.centers.row(c2.idx())).square().sum() + 
+						moments.variances[c1.idx()] + moments.variances[c2.idx()];
+				}
+
+			private:
+				const Moments& moments;
+		};
+
 		// Distance matrix
 		
 		template<class Cluster, class Matrix, class Distance=typename Matrix::Scalar>
@@ -178,35 +680,107 @@ namespace Rclusterpp {
 		template<class Cluster>
 		struct WardsMerge : public MergeFunctor<Cluster> {									
 			void operator()(Cluster& co, const Cluster& c1, const Cluster& c2, const Util::IndexList&) const {
-				co.set_center( ((c1.center() * c1.size()) + (c2.center() * c2.size())) / co.size() );
+				co.set_center( ((c1.center() * c1.weight()) + (c2.center() * c2.weight())) / co.weight() );
 			}
 		};
 
 
+		template<class Cluster, class Centers>
+		class StoredCentersWardsMerge : public MergeFunctor<Cluster> {
+			public:
+				StoredCentersWardsMerge(Centers& c) : centers(c) {}
+
+				void operator()(Cluster& co, const Cluster& c1, const Cluster& c2, const Util::IndexList&) const {
+					// Output idx is the lesser of the two merged idxs, so this update is in place
+					centers.row(co.idx()) = ((centers.row(c1.idx()) * c1.weight()) + (centers.row(c2.idx()) * c2.weight())) / co.weight();
+				}
+
+			private:
+				Centers& centers;
+		};
+
+		template<class Cluster, class Moments>
+		class MomentsMerge : public MergeFunctor<Cluster> {
+			public:
+				MomentsMerge(Moments& m) : moments(m) {}
+
+				void operator()(Cluster& co, const Cluster& c1, const Cluster& c2, const Util::IndexList&) const {
+					typedef typename Moments::value_type value_type;
+					
+					// Output idx is the lesser of the two merged idxs, so the variance is computed before the center
+					// is updated in place
+					value_type w1 = c1.weight() / co.weight(), w2 = c2.weight() / co.weight();
+					moments.variances[co.idx()] = (w1 * moments.variances[c1.idx()]) + (w2 * moments.variances[c2.idx()]) + 
+						(w1 * w2 * (moments.centers.row(c1.idx()) - moments.centers.row(c2.idx())).square().sum());
+					moments.centers.row(co.idx()) = (moments.centers.row(c1.idx()) * w1) + (moments.centers.row(c2.idx()) * w2);
+				}
+
+			private:
+				Moments& moments;
+		};
+
+		// The median (Gower's) linkage weights both parents equally, regardless of their size
+		template<class Cluster, class Centers>
+		class StoredCentersMedianMerge : public MergeFunctor<Cluster> {
+			public:
+				StoredCentersMedianMerge(Centers& c) : centers(c) {}
+
+				void operator()(Cluster& co, const Cluster& c1, const Cluster& c2, const Util::IndexList&) const {
+					centers.row(co.idx()) = (centers.row(c1.idx()) + centers.row(c2.idx())) * 0.5;
+				}
+
+			private:
+				Centers& centers;
+		};
+
+
 		template<class Cluster, class Distance>
 		struct AverageUpdate {
-			Distance alpha(const Cluster& ci, const Cluster& co) const { return (Distance)ci.size() / co.size(); }
+			Distance alpha(const Cluster& ci, const Cluster& co) const { return (Distance)ci.weight() / co.weight(); }
+			Distance beta(const Cluster& ca, const Cluster& cb, const Cluster& co) const { return 0.; }
 			Distance gamma() const { return 0.; }
 		};
 
 		template<class Cluster, class Distance>
 		struct SingleUpdate {
 			Distance alpha(const Cluster& ci, const Cluster& co) const { return 0.5; }
+			Distance beta(const Cluster& ca, const Cluster& cb, const Cluster& co) const { return 0.; }
 			Distance gamma() const { return -0.5; }
 		};
 
 		template<class Cluster, class Distance>
 		struct CompleteUpdate {
 			Distance alpha(const Cluster& ci, const Cluster& co) const { return 0.5; }
+			Distance beta(const Cluster& ca, const Cluster& cb, const Cluster& co) const { return 0.; }
 			Distance gamma() const { return 0.5; }
 		};
 
+		// Centroid and median updates are only meaningful for squared Euclidean distances 
+
+		template<class Cluster, class Distance>
+		struct CentroidUpdate {
+			Distance alpha(const Cluster& ci, const Cluster& co) const { return (Distance)ci.weight() / co.weight(); }
+			Distance beta(const Cluster& ca, const Cluster& cb, const Cluster& co) const { 
+				return -((Distance)ca.weight() * cb.weight()) / ((Distance)co.weight() * co.weight()); 
+			}
+			Distance gamma() const { return 0.; }
+		};
+
+		template<class Cluster, class Distance>
+		struct MedianUpdate {
+			Distance alpha(const Cluster& ci, const Cluster& co) const { return 0.5; }
+			Distance beta(const Cluster& ca, const Cluster& cb, const Cluster& co) const { return -0.25; }
+			Distance gamma() const { return 0.; }
+		};
+
 
 		template<class Cluster, class Matrix, class Update>
 		class LanceWilliamsMerge : public MergeFunctor<Cluster> {
 			public:
 				typedef typename Matrix::Scalar distance_type;
 				
+				static const bool team_merge = true;
+
 				LanceWilliamsMerge(Matrix& m, const Update& u) : distance(m), update(u) {}
 
 				// TODO: Note currently assuming strictly lower matrix, attempt to use template
@@ -221,18 +795,35 @@ namespace Rclusterpp {
 					distance_type aA = update.alpha(ca, co);
 					distance_type aB = update.alpha(cb, co); 
 					distance_type gm = update.gamma();
+					distance_type bt = update.beta(ca, cb, co) * co.disimilarity();  // Constant term, zero for most linkages
 
-					size_t i=valids.begin();
-					for (; i<ai; i=valids.succ(i)) {  // Recall ai == oi && ai < bi
-						distance.coeffRef(oi, i) = aA * distance.coeff(ai, i) + aB * distance.coeff(bi, i) + gm * std::abs(distance.coeff(ai, i) - distance.coeff(bi, i));
+					// Recall ai == oi && ai < bi, and bi is no longer valid. The diagonal (at pa) is skipped.
+					ssize_t pa = valids.position(ai), pb = valids.position(bi), pe = valids.size();
+					
+#ifdef _OPENMP
+					#pragma omp for schedule(static) nowait
+#endif
+					for (ssize_t p=0; p<pa; p++) {  
+						size_t i = valids[p];
+						distance.coeffRef(oi, i) = aA * distance.coeff(ai, i) + aB * distance.coeff(bi, i) + bt + gm * std::abs(distance.coeff(ai, i) - distance.coeff(bi, i));
 					}
-					for (; i<bi; i=valids.succ(i)) {
-						distance.coeffRef(i, oi) = aA * distance.coeff(i, ai) + aB * distance.coeff(bi, i) + gm * std::abs(distance.coeff(i, ai) - distance.coeff(bi, i));
+#ifdef _OPENMP
+					#pragma omp for schedule(static) nowait
+#endif
+					for (ssize_t p=pa+1; p<pb; p++) {
+						size_t i = valids[p];
+						distance.coeffRef(i, oi) = aA * distance.coeff(i, ai) + aB * distance.coeff(bi, i) + bt + gm * std::abs(distance.coeff(i, ai) - distance.coeff(bi, i));
 					}
-					for (; i<valids.end(); i=valids.succ(i)) {
-						distance.coeffRef(i, oi) = aA * distance.coeff(i, ai) + aB * distance.coeff(i, bi) + gm * std::abs(distance.coeff(i, ai) - distance.coeff(i, bi));
+#ifdef _OPENMP
+					#pragma omp for schedule(static) nowait
+#endif
+					for (ssize_t p=pb; p<pe; p++) {
+						size_t i = valids[p];
+						distance.coeffRef(i, oi) = aA * distance.coeff(i, ai) + aB * distance.coeff(i, bi) + bt + gm * std::abs(distance.coeff(i, ai) - distance.coeff(i, bi));
 					}
-					
+#ifdef _OPENMP
+					#pragma omp barrier
+#endif					
 					return;
 				}
 
@@ -261,29 +852,55 @@ namespace Rclusterpp {
 
 	// Clustering from stored data
 
+	template<class Matrix, class Distance>
+	Methods::DistanceFromStoredDataRows<Matrix, Distance> stored_data_rows(const Matrix& m, Distance d) {
+		return Methods::DistanceFromStoredDataRows<Matrix, Distance>(m, d);
+	}
+
+	// Euclidean (or, if Squared, squared Euclidean) distances between stored data rows, computed in blocks
+	template<bool Squared, class Matrix>
+	Methods::EuclideanBlocks<Matrix, Squared> stored_data_blocks(const Matrix& m) {
+		return Methods::EuclideanBlocks<Matrix, Squared>(m);
+	}
+
+	// Cosine (or Pearson correlation) distances between stored data rows already normalized (and centered), see
+	// Methods::normalize_rows
+	template<class Matrix>
+	Methods::NormalizedBlocks<Matrix> stored_normalized_blocks(const Matrix& m) {
+		return Methods::NormalizedBlocks<Matrix>(m);
+	}
+
 #define CONST_ROW Matrix::ConstRowXpr
 
+	// Runtime selection of the distance. Every distance computation is an indirect call, prefer
+	// selecting the distance functor once and using the overload above in performance critical code.
 	template<class Matrix>
 	Methods::DistanceFromStoredDataRows<
 		Matrix, typename std::function<typename Matrix::RealScalar(typename CONST_ROW&, typename CONST_ROW&)> 
 	> 
 	stored_data_rows(const Matrix& m, DistanceKinds dk, double minkowski=1.0) {
+		typedef typename Matrix::RealScalar scalar_type;
 		typedef Methods::DistanceFromStoredDataRows<
-			Matrix, typename std::function<typename Matrix::RealScalar(typename CONST_ROW&, typename CONST_ROW&)> 
+			Matrix, typename std::function<scalar_type(typename CONST_ROW&, typename CONST_ROW&)> 
 		> distancer_type;
 
 		switch (dk) {
 			default: 
         throw std::invalid_argument("Linkage or distance method not yet supported");
 			case Rclusterpp::EUCLIDEAN:
-				return distancer_type(m, Methods::euclidean_distance<typename CONST_ROW>);
+				return distancer_type(m, Methods::EuclideanDistance<scalar_type>());
 			case Rclusterpp::MANHATTAN:
-				return distancer_type(m, Methods::manhattan_distance<typename CONST_ROW>);
+				return distancer_type(m, Methods::ManhattanDistance<scalar_type>());
 			case Rclusterpp::MAXIMUM:
-				return distancer_type(m, Methods::maximum_distance<typename CONST_ROW>);
+				return distancer_type(m, Methods::MaximumDistance<scalar_type>());
 			case Rclusterpp::MINKOWSKI:
-				Methods::minkowski_power_g = minkowski;
-				return distancer_type(m, Methods::minkowski_distance<typename CONST_ROW>);
+				return distancer_type(m, Methods::MinkowskiDistance<scalar_type>(minkowski));
+			case Rclusterpp::SQEUCLIDEAN:
+				return distancer_type(m, Methods::SquaredEuclideanDistance<scalar_type>());
+			case Rclusterpp::COSINE:
+				return distancer_type(m, Methods::CosineDistance<scalar_type>());
+			case Rclusterpp::PEARSON:
+				return distancer_type(m, Methods::PearsonDistance<scalar_type>());
 
 		}
 	}
@@ -295,6 +912,50 @@ namespace Rclusterpp {
 		return LinkageMethod<Cluster, Methods::WardsLink<Cluster>, Methods::WardsMerge<Cluster> >();
 	}
 
+	template<class Cluster, class Value>
+	LinkageMethod<Cluster, Methods::StoredCentersWardsLink<Cluster, Methods::StoredCenters<Value> >, Methods::StoredCentersWardsMerge<Cluster, Methods::StoredCenters<Value> > > 
+	wards_link(Methods::StoredCenters<Value>& centers) {
+		typedef Methods::StoredCenters<Value> centers_type;
+		return LinkageMethod<Cluster, Methods::StoredCentersWardsLink<Cluster, centers_type>, Methods::StoredCentersWardsMerge<Cluster, centers_type> >(
+			Methods::StoredCentersWardsLink<Cluster, centers_type>(centers),
+			Methods::StoredCentersWardsMerge<Cluster, centers_type>(centers)
+		);
+	}
+
+	// Centroid and median linkages (which are not reducible) from stored centers. Note that the centroids are
+	// updated exactly as for Ward's linkage.
+
+	template<class Cluster, class Value>
+	LinkageMethod<Cluster, Methods::StoredCentersCentroidLink<Cluster, Methods::StoredCenters<Value> >, Methods::StoredCentersWardsMerge<Cluster, Methods::StoredCenters<Value> > > 
+	centroid_link(Methods::StoredCenters<Value>& centers) {
+		typedef Methods::StoredCenters<Value> centers_type;
+		return LinkageMethod<Cluster, Methods::StoredCentersCentroidLink<Cluster, centers_type>, Methods::StoredCentersWardsMerge<Cluster, centers_type> >(
+			Methods::StoredCentersCentroidLink<Cluster, centers_type>(centers),
+			Methods::StoredCentersWardsMerge<Cluster, centers_type>(centers)
+		);
+	}
+
+	template<class Cluster, class Value>
+	LinkageMethod<Cluster, Methods::StoredCentersCentroidLink<Cluster, Methods::StoredCenters<Value> >, Methods::StoredCentersMedianMerge<Cluster, Methods::StoredCenters<Value> > > 
+	median_link(Methods::StoredCenters<Value>& centers) {
+		typedef Methods::StoredCenters<Value> centers_type;
+		return LinkageMethod<Cluster, Methods::StoredCentersCentroidLink<Cluster, centers_type>, Methods::StoredCentersMedianMerge<Cluster, centers_type> >(
+			Methods::StoredCentersCentroidLink<Cluster, centers_type>(centers),
+			Methods::StoredCentersMedianMerge<Cluster, centers_type>(centers)
+		);
+	}
+
+	// Average linkage for squared Euclidean distance, computed from the stored cluster moments
+	template<class Cluster, class Value>
+	LinkageMethod<Cluster, Methods::AverageSquaredLink<Cluster, Methods::StoredMoments<Value> >, Methods::MomentsMerge<Cluster, Methods::StoredMoments<Value> > > 
+	average_sqeuclidean_link(Methods::StoredMoments<Value>& moments) {
+		typedef Methods::StoredMoments<Value> moments_type;
+		return LinkageMethod<Cluster, Methods::AverageSquaredLink<Cluster, moments_type>, Methods::MomentsMerge<Cluster, moments_type> >(
+			Methods::AverageSquaredLink<Cluster, moments_type>(moments),
+			Methods::MomentsMerge<Cluster, moments_type>(moments)
+		);
+	}
+
 	template<class Cluster, class Distance>
 	LinkageMethod<Cluster, Methods::AverageLink<Cluster, Distance>, Methods::NoOpMerge<Cluster> > average_link(Distance d) {
 		return LinkageMethod<Cluster, Methods::AverageLink<Cluster, Distance>, Methods::NoOpMerge<Cluster> >(
@@ -338,6 +999,16 @@ LinkageMethod<Cluster, Methods::StoredDistance<Cluster, Matrix>, Methods::LanceW
 		return lancewilliams<Cluster>(m, Methods::CompleteUpdate<Cluster,typename Matrix::Scalar>());
 	}
 
+	template<class Cluster, class Matrix>
+	RETURN_TYPE(Centroid) centroid_link(Matrix& m, FromDistanceKinds) {
+		return lancewilliams<Cluster>(m, Methods::CentroidUpdate<Cluster,typename Matrix::Scalar>());
+	}
+
+	template<class Cluster, class Matrix>
+	RETURN_TYPE(Median) median_link(Matrix& m, FromDistanceKinds) {
+		return lancewilliams<Cluster>(m, Methods::MedianUpdate<Cluster,typename Matrix::Scalar>());
+	}
+
 #undef RETURN_TYPE
 
 } // end of Rclusterpp namespace
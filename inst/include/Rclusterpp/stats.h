@@ -0,0 +1,196 @@
+#ifndef RCLUSTERPP_STATS_H
+#define RCLUSTERPP_STATS_H
+
+// Instrumentation of the clustering engines, which is compiled out unless RCLUSTERPP_STATS is defined (e.g., by
+// adding -DRCLUSTERPP_STATS to PKG_CXXFLAGS in src/Makevars). Each thread updates its own counters, without
+// synchronization, and the counters of all of the threads are combined when collected. The statistics are
+// process-wide: concurrent clusterings (e.g., in a batch) are counted together, and the counters should only be
+// reset or collected when no clustering is running.
+//
+// Memory is accounted by the data structures themselves (e.g., the cluster storage, stored centers, neighbor
+// caches and distance matrices), with a Memory member updated with the bytes the structure has allocated. The
+// peak is the maximum of the total over all of the structures since the last reset.
+
+#ifdef RCLUSTERPP_STATS
+
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace Rclusterpp {
+
+	namespace Stats {
+
+		enum Counters {
+			DISTANCES,      // Linkage distances evaluated between pairs of clusters
+			EARLY_EXITS,    // Average and complete linkage evaluations abandoned once past the threshold
+			CHAIN_PUSHES,   // Clusters pushed onto the nearest neighbor chain
+			CHAIN_POPS,     // Clusters popped from the nearest neighbor chain
+			MAX_CHAIN,      // Longest nearest neighbor chain (maximum)
+			NEIGHBOR_TIME,  // Time in the nearest neighbor searches
+			MERGE_TIME,     // Time merging clusters
+			POPULATE_TIME,  // Time translating the clusters into the hclust result
+			PEAK_BYTES,     // Peak memory allocated by the clustering data structures
+			NUM_COUNTERS
+		};
+
+		inline const char* name(int counter) {
+			static const char* names[NUM_COUNTERS] = {
+				"distance_evaluations", "early_exits", "chain_pushes", "chain_pops", "max_chain",
+				"neighbor_time", "merge_time", "populate_time", "peak_bytes"
+			};
+			return names[counter];
+		}
+
+		inline bool is_maximum(int counter) { return counter == MAX_CHAIN; }
+
+		inline bool is_time(int counter) { return counter == NEIGHBOR_TIME || counter == MERGE_TIME || counter == POPULATE_TIME; }
+
+		struct ThreadCounters {
+			unsigned long long values[NUM_COUNTERS];  // Times are in nanoseconds
+
+			ThreadCounters() { std::fill(values, values + NUM_COUNTERS, 0ULL); }
+		};
+
+		inline int thread_num() {
+#ifdef _OPENMP
+			return omp_get_thread_num();
+#else
+			return 0;
+#endif
+		}
+
+		inline std::vector<ThreadCounters*>& registry() {
+			static std::vector<ThreadCounters*> threads;
+			return threads;
+		}
+
+		// Counters for the calling thread, which are registered on first use and never released, so that
+		// the counts outlive the thread
+		inline ThreadCounters& local() {
+			static thread_local ThreadCounters* counters = NULL;
+			if (!counters) {
+				counters = new ThreadCounters();
+#ifdef _OPENMP
+				#pragma omp critical (rclusterpp_stats)
+#endif
+				registry().push_back(counters);
+			}
+			return *counters;
+		}
+
+		inline void add(Counters counter, unsigned long long n) { local().values[counter] += n; }
+
+		inline void maximum(Counters counter, unsigned long long n) {
+			unsigned long long& value = local().values[counter];
+			value = std::max(value, n);
+		}
+
+		// Bytes currently allocated by the clustering data structures (shared by all threads), and the peak
+		inline std::atomic<long long>& allocated() { static std::atomic<long long> bytes(0); return bytes; }
+		inline std::atomic<long long>& peak() { static std::atomic<long long> bytes(0); return bytes; }
+
+		inline void allocate(long long bytes) {
+			long long now = (allocated() += bytes), before = peak().load();
+			while (now > before && !peak().compare_exchange_weak(before, now)) {}
+		}
+
+		// Accounts for the memory allocated by the data structure that owns it, set as the structure grows
+		class Memory {
+			public:
+				Memory() : bytes_(0) {}
+				Memory(const Memory& other) : bytes_(0) { set(other.bytes_); }
+				Memory& operator=(const Memory& other) { set(other.bytes_); return *this; }
+				~Memory() { set(0); }
+
+				void set(size_t bytes) {
+					allocate((long long)bytes - (long long)bytes_);
+					bytes_ = bytes;
+				}
+
+			private:
+				size_t bytes_;
+		};
+
+		inline void reset() {
+#ifdef _OPENMP
+			#pragma omp critical (rclusterpp_stats)
+#endif
+			for (size_t t=0; t<registry().size(); t++)
+				*(registry()[t]) = ThreadCounters();
+			peak() = allocated().load();
+		}
+
+		// Sum (or maximum) of each counter over all threads, with times in seconds
+		inline std::vector<double> collect() {
+			std::vector<double> result(NUM_COUNTERS, 0.);
+#ifdef _OPENMP
+			#pragma omp critical (rclusterpp_stats)
+#endif
+			for (size_t t=0; t<registry().size(); t++) {
+				for (int c=0; c<NUM_COUNTERS; c++) {
+					double value = registry()[t]->values[c];
+					result[c] = is_maximum(c) ? std::max(result[c], value) : result[c] + value;
+				}
+			}
+			for (int c=0; c<NUM_COUNTERS; c++) {
+				if (is_time(c))
+					result[c] *= 1e-9;
+			}
+			result[PEAK_BYTES] = peak().load();
+			return result;
+		}
+
+		// Add the wall time between construction and destruction to the counter. If team is true, only the
+		// first thread in the team records the time, so that work shared by the team is counted once.
+		class ScopedTimer {
+			public:
+				typedef std::chrono::steady_clock clock_type;
+
+				ScopedTimer(Counters counter, bool team=false) :
+					counter_(counter), record_(!team || thread_num() == 0), start_(clock_type::now()) {}
+
+				~ScopedTimer() {
+					if (record_)
+						add(counter_, std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - start_).count());
+				}
+
+			private:
+				Counters               counter_;
+				bool                   record_;
+				clock_type::time_point start_;
+		};
+
+	} // end of Stats namespace
+
+} // end of Rclusterpp namespace
+
+#define RCLUSTERPP_STATS_ADD(counter, n) Rclusterpp::Stats::add(Rclusterpp::Stats::counter, (n))
+#define RCLUSTERPP_STATS_TEAM_ADD(counter, n) do { if (Rclusterpp::Stats::thread_num() == 0) Rclusterpp::Stats::add(Rclusterpp::Stats::counter, (n)); } while (0)
+#define RCLUSTERPP_STATS_MAX(counter, n) Rclusterpp::Stats::maximum(Rclusterpp::Stats::counter, (n))
+#define RCLUSTERPP_STATS_TIME(counter) Rclusterpp::Stats::ScopedTimer rclusterpp_stats_timer_(Rclusterpp::Stats::counter)
+#define RCLUSTERPP_STATS_TEAM_TIME(counter) Rclusterpp::Stats::ScopedTimer rclusterpp_stats_timer_(Rclusterpp::Stats::counter, true)
+#define RCLUSTERPP_STATS_RESET() Rclusterpp::Stats::reset()
+// Declares a Memory member (or local) name, used without a trailing semicolon so it can be compiled out
+#define RCLUSTERPP_STATS_MEMORY(name) Rclusterpp::Stats::Memory name;
+#define RCLUSTERPP_STATS_ALLOCATED(name, bytes) (name).set(bytes)
+
+#else
+
+#define RCLUSTERPP_STATS_ADD(counter, n) ((void)0)
+#define RCLUSTERPP_STATS_TEAM_ADD(counter, n) ((void)0)
+#define RCLUSTERPP_STATS_MAX(counter, n) ((void)0)
+#define RCLUSTERPP_STATS_TIME(counter) ((void)0)
+#define RCLUSTERPP_STATS_TEAM_TIME(counter) ((void)0)
+#define RCLUSTERPP_STATS_RESET() ((void)0)
+#define RCLUSTERPP_STATS_MEMORY(name)
+#define RCLUSTERPP_STATS_ALLOCATED(name, bytes) ((void)0)
+
+#endif // RCLUSTERPP_STATS
+
+#endif
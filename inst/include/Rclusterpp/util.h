@@ -1,10 +1,76 @@
 #ifndef RCLUSTERP_UTIL_H
 #define RCLUSTERP_UTIL_H
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#if !defined(_WIN32)
+#define RCLUSTERPP_HAVE_MMAP
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#if !defined(__APPLE__)
+#define RCLUSTERPP_HAVE_FALLOCATE
+#endif
+#endif
+
+#include <Rclusterpp/stats.h>
+
 namespace Rclusterpp {
 
 	namespace Util {
 			
+		// Thread team helpers that degrade gracefully when OpenMP is not available 
+
+		inline int thread_num() {
+#ifdef _OPENMP
+			return omp_get_thread_num();
+#else
+			return 0;
+#endif
+		}
+
+		inline int team_size() {
+#ifdef _OPENMP
+			return omp_get_num_threads();
+#else
+			return 1;
+#endif
+		}
+
+		inline int max_threads() {
+#ifdef _OPENMP
+			return omp_get_max_threads();
+#else
+			return 1;
+#endif
+		}
+
+		// Per-thread storage for reductions within a thread team of at most threads threads. Must be created 
+		// outside of the parallel region. Slots are padded to avoid false sharing between threads.
+		template<class T>
+		class TeamSlots {
+			private:
+				struct Slot {
+					T    value;
+					char padding[64];
+				};
+
+			public:
+				explicit TeamSlots(int threads=max_threads()) : slots_(threads) {}
+
+				T& local() { return slots_[thread_num()].value; }
+				
+				T& operator[](size_t i) { return slots_[i].value; }
+				const T& operator[](size_t i) const { return slots_[i].value; }
+
+			private:
+				std::vector<Slot> slots_;
+		};
+
 		template<class OP>
 		class ClusterBinder {
 		public:
@@ -26,39 +92,355 @@ namespace Rclusterpp {
 		} 
 
 
+		template<class T>
+		struct FirstEqualTo {
+			T value;
+			FirstEqualTo(T v) : value(v) {}
+			template<class P>
+			bool operator()(const P& p) const { return p.first == value; }
+		};
+
+		template<class T>
+		inline FirstEqualTo<T> first_equal_to(T v) { return FirstEqualTo<T>(v); }
+
+		struct SecondLess {
+			template<class P>
+			bool operator()(const P& a, const P& b) const { return a.second < b.second; }
+		};
+
+		inline SecondLess second_less() { return SecondLess(); }
+
+		// Order pairs of clusters by the lesser idx in each pair
+		struct PairLessIdx {
+			template<class P>
+			bool operator()(const P& a, const P& b) const { 
+				return std::min(a.first->idx(), a.second->idx()) < std::min(b.first->idx(), b.second->idx()); 
+			}
+		};
+
+		inline PairLessIdx pair_less_idx() { return PairLessIdx(); }
+
+		// Sorted set of valid cluster idxs. The idxs are stored contiguously so that they can be traversed
+		// by position, e.g., divided among the threads of a team.
 		class IndexList {
 			private:
-				typedef std::vector<std::pair<size_t, size_t> > indexes_type;
+				typedef std::vector<size_t> indexes_type;
 		
 			public:
-				IndexList(size_t n) : idxs(n+1), begin_(0), end_(n) {
-					idxs[0] = std::make_pair(0, 1);
-					for (size_t i=1; i<end_; i++)
-						idxs[i] = std::make_pair(i-1, i+1);
+				IndexList(size_t n) : idxs(n) {
+					for (size_t i=0; i<n; i++)
+						idxs[i] = i;
 				}
 
-				size_t begin() const { return begin_; }
-				size_t end() const { return end_; }
-
-				size_t succ(size_t i) const {
-					return idxs[i].second;
+				size_t size() const { return idxs.size(); }
+				size_t operator[](size_t p) const { return idxs[p]; }
+				
+				// Position of the first valid idx not less than i
+				size_t position(size_t i) const {
+					return std::lower_bound(idxs.begin(), idxs.end(), i) - idxs.begin();
 				}
 
 				void remove(size_t i) {
-					if (i == begin_) {
-						begin_ = idxs[i].second;
-					} else {
-						idxs[idxs[i].first].second = idxs[i].second;
-						idxs[idxs[i].second].first = idxs[i].first;
-					}
+					indexes_type::iterator p = std::lower_bound(idxs.begin(), idxs.end(), i);
+					if (p != idxs.end() && *p == i)
+						idxs.erase(p);
 				}
  
 			private:
 				indexes_type idxs;
-				size_t       begin_, end_;
+		};
+
+		// Binary min-heap of keys indexed by idx (which must be less than n), supporting updates to, and removal
+		// of, arbitrary idxs. Ties are broken by idx.
+		template<class Key>
+		class IndexedHeap {
+			public:
+				IndexedHeap(size_t n) : keys_(n), position_(n, npos()) {}
+
+				bool empty() const { return heap_.empty(); }
+				size_t top() const { return heap_.front(); }
+				
+				bool contains(size_t idx) const { return position_[idx] != npos(); }
+				Key key(size_t idx) const { return keys_[idx]; }
+
+				void push(size_t idx, Key key) {
+					keys_[idx] = key;
+					position_[idx] = heap_.size();
+					heap_.push_back(idx);
+					sift_up(heap_.size() - 1);
+				}
+
+				void update(size_t idx, Key key) {
+					keys_[idx] = key;
+					sift_down(sift_up(position_[idx]));
+				}
+
+				void remove(size_t idx) {
+					size_t p = position_[idx], l = heap_.size() - 1;
+					swap(p, l);
+					heap_.pop_back();
+					position_[idx] = npos();
+					if (p < l)
+						sift_down(sift_up(p));
+				}
+
+			private:
+				static size_t npos() { return std::numeric_limits<size_t>::max(); }
+
+				bool less(size_t a, size_t b) const {
+					return keys_[heap_[a]] < keys_[heap_[b]] || (!(keys_[heap_[b]] < keys_[heap_[a]]) && heap_[a] < heap_[b]);
+				}
+
+				void swap(size_t a, size_t b) {
+					std::swap(heap_[a], heap_[b]);
+					position_[heap_[a]] = a;
+					position_[heap_[b]] = b;
+				}
+
+				size_t sift_up(size_t p) {
+					while (p > 0 && less(p, (p - 1) / 2)) {
+						swap(p, (p - 1) / 2);
+						p = (p - 1) / 2;
+					}
+					return p;
+				}
+
+				void sift_down(size_t p) {
+					while (true) {
+						size_t c = 2 * p + 1;
+						if (c >= heap_.size())
+							break;
+						if (c + 1 < heap_.size() && less(c + 1, c))
+							c++;
+						if (!less(c, p))
+							break;
+						swap(p, c);
+						p = c;
+					}
+				}
+
+				std::vector<Key>    keys_;
+				std::vector<size_t> position_;  // Position of each idx in the heap
+				std::vector<size_t> heap_;
+		};
+
+		// Scratch file mapped into memory, e.g., for out-of-core storage of large matrices. The file is
+		// unlinked as soon as it is created, so that it is removed when the mapping is released. The disk
+		// blocks are reserved up front (where supported), so that a full scratch filesystem is reported as an
+		// error here, instead of as a SIGBUS when a page of the mapping is first written.
+		class MappedFile {
+			public:
+				MappedFile(const std::string& dir, size_t bytes) : data_(NULL), bytes_(bytes) {
+#ifdef RCLUSTERPP_HAVE_MMAP
+					if (bytes_ == 0)
+						return;
+					
+					std::string path = dir + "/RclusterppXXXXXX";
+					std::vector<char> name(path.begin(), path.end());
+					name.push_back('\0');
+					
+					int fd = mkstemp(&name[0]);
+					if (fd == -1)
+						throw std::runtime_error("Unable to create scratch file in " + dir);
+					unlink(&name[0]);
+
+					if (!allocate(fd, bytes_)) {
+						close(fd);
+						throw std::runtime_error("Unable to allocate scratch file in " + dir);
+					}
+					
+					void* m = mmap(NULL, bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+					close(fd);
+					if (m == MAP_FAILED)
+						throw std::runtime_error("Unable to map scratch file in " + dir);
+					data_ = m;
+					RCLUSTERPP_STATS_ALLOCATED(memory_, bytes_);
+#else
+					throw std::runtime_error("Memory-mapped scratch files are not supported on this platform");
+#endif
+				}
+
+				~MappedFile() {
+#ifdef RCLUSTERPP_HAVE_MMAP
+					if (data_)
+						munmap(data_, bytes_);
+#endif
+				}
+
+				void* data() { return data_; }
+				size_t size() const { return bytes_; }
+
+			private:
+				MappedFile(const MappedFile&);
+				MappedFile& operator=(const MappedFile&);
+
+#ifdef RCLUSTERPP_HAVE_MMAP
+				// Size the file, falling back to a (sparse) ftruncate if the filesystem can't reserve the blocks
+				static bool allocate(int fd, size_t bytes) {
+#ifdef RCLUSTERPP_HAVE_FALLOCATE
+					int err = posix_fallocate(fd, 0, bytes);
+					if (err == 0)
+						return true;
+					if (err != EINVAL && err != EOPNOTSUPP)
+						return false;  // E.g., ENOSPC or EFBIG
+#endif
+					return ftruncate(fd, bytes) == 0;
+				}
+#endif
+
+				void*  data_;
+				size_t bytes_;
+				RCLUSTERPP_STATS_MEMORY(memory_)
+		};
+
+		// Unordered set of active clusters supporting O(1) insertion, removal and lookup by idx.
+		// Clusters are tracked by their idx, which must be less than n.
+		template<class T>
+		class ActiveList {
+			private:
+				typedef std::vector<T*> clusters_type;
+
+			public:
+				typedef typename clusters_type::iterator iterator;
+
+				template<class Iterator>
+				ActiveList(Iterator first, Iterator last, size_t n) : clusters_(first, last), position_(n) {
+					for (size_t i=0; i<clusters_.size(); i++)
+						position_[clusters_[i]->idx()] = i;
+				}
+
+				iterator begin() { return clusters_.begin(); }
+				iterator end() { return clusters_.end(); }
+
+				size_t size() const { return clusters_.size(); }
+				bool empty() const { return clusters_.empty(); }
+				T* back() const { return clusters_.back(); }
+				T* at(size_t idx) const { return clusters_[position_[idx]]; }
+
+				void insert(T* c) {
+					position_[c->idx()] = clusters_.size();
+					clusters_.push_back(c);
+				}
+
+				void remove(T const* c) {
+					move_to_back(c);
+					clusters_.pop_back();
+				}
+
+				void move_to_back(T const* c) {
+					size_t p = position_[c->idx()], l = clusters_.size() - 1;
+					std::swap(clusters_[p], clusters_[l]);
+					position_[clusters_[p]->idx()] = p;
+					position_[clusters_[l]->idx()] = l;
+				}
+
+			private:
+				clusters_type       clusters_;
+				std::vector<size_t> position_;
+		};
+
+		// Bounded nearest neighbor lists, indexed by cluster idx. Each list holds up to k neighbors
+		// along with a bound such that any active cluster not descended from a listed neighbor is at
+		// least that far away. For reducible linkages a merged cluster is no closer to a third cluster
+		// than the nearer of its parents, so the lists (and bound) remain correct as clusters merge
+		// and the union of the parents' lists is a correct list for the merged cluster.
+		template<class T, class Distance>
+		class NeighborCache {
+			public:
+				typedef Distance distance_type;
+
+				struct entry_type {
+					T const*      cluster;
+					distance_type distance;
+					bool          known;  // Is distance current, or does it need to be recomputed
+				};
+
+				NeighborCache(size_t n, size_t k) :
+					k_(k), entries_(n * 2 * k), count_(n, 0), bound_(n, std::numeric_limits<distance_type>::lowest()), root_(n) {
+					for (size_t i=0; i<n; i++)
+						root_[i] = i;
+					RCLUSTERPP_STATS_ALLOCATED(memory_, entries_.size() * sizeof(entry_type) + n * (sizeof(size_t) * 2 + sizeof(distance_type)));
+				}
+
+				size_t capacity() const { return k_; }
+
+				entry_type* begin(size_t idx) { return &entries_[idx * 2 * k_]; }
+				entry_type* end(size_t idx) { return begin(idx) + count_[idx]; }
+				distance_type bound(size_t idx) const { return bound_[idx]; }
+
+				// Replace the list for idx with [first, last), assumed to be sorted by distance. Entries
+				// beyond the capacity are dropped, tightening the bound as needed.
+				template<class Iterator>
+				void assign(size_t idx, Iterator first, Iterator last, distance_type bound) {
+					size_t n = std::min<size_t>(last - first, k_);
+					if (n < (size_t)(last - first))
+						bound = std::min(bound, (first + n)->second);
+					entry_type* e = begin(idx);
+					for (size_t i=0; i<n; i++, ++first) {
+						e[i].cluster  = first->first;
+						e[i].distance = first->second;
+						e[i].known    = true;
+					}
+					count_[idx] = n;
+					bound_[idx] = bound;
+				}
+
+				// Combine the lists for clusters at idxs into and from (which is no longer valid)
+				void merge(size_t into, size_t from) {
+					root_[from] = into;
+					if (count_[into] + count_[from] > 2 * k_) {
+						count_[into] = 0;
+						bound_[into] = std::numeric_limits<distance_type>::lowest();
+						return;
+					}
+					std::copy(begin(from), end(from), end(into));
+					count_[into] += count_[from];
+					bound_[into] = std::min(bound_[into], bound_[from]);
+					for (entry_type* e=begin(into); e!=end(into); ++e)
+						e->known = false;
+				}
+
+				// Current idx of the cluster that contains the cluster originally at idx
+				size_t find(size_t idx) {
+					size_t r = idx;
+					while (root_[r] != r)
+						r = root_[r];
+					while (root_[idx] != r) {
+						size_t n = root_[idx];
+						root_[idx] = r;
+						idx = n;
+					}
+					return r;
+				}
+
+			private:
+				size_t                     k_;
+				std::vector<entry_type>    entries_;
+				std::vector<size_t>        count_;
+				std::vector<distance_type> bound_;
+				std::vector<size_t>        root_;
+				RCLUSTERPP_STATS_MEMORY(memory_)
 		};
 	
 	} // end of Util namespace
+
+	// Settings for a single clustering (or other parallel computation), passed explicitly instead of through
+	// process-global OpenMP state (i.e., omp_set_num_threads), so that concurrent computations in one process
+	// don't interfere with each other. Every parallel region uses a team of (at most) threads() threads,
+	// which defaults to the current OpenMP maximum. Callers can also request that reducible linkages grow
+	// many nearest neighbor chains in parallel (see cluster_via_rnn with ParallelChains).
+	class ExecutionContext {
+		public:
+			explicit ExecutionContext(int threads=0, bool parallel_chains=false) : 
+				threads_((threads > 0) ? threads : Util::max_threads()), parallel_chains_(parallel_chains) {}
+
+			int threads() const { return threads_; }
+			bool parallel_chains() const { return parallel_chains_; }
+
+		private:
+			int  threads_;
+			bool parallel_chains_;
+	};
 	
 } // end of Rclusterpp namespace
 
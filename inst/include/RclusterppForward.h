@@ -7,14 +7,24 @@ namespace Rclusterpp {
 		WARD,
 		AVERAGE,
 		SINGLE,
-		COMPLETE
+		COMPLETE,
+		CENTROID,
+		MEDIAN
 	};
 
 	enum DistanceKinds {
 		EUCLIDEAN,
 		MANHATTAN,
 		MAXIMUM,
-		MINKOWSKI
+		MINKOWSKI,
+		SQEUCLIDEAN,
+		COSINE,
+		PEARSON
+	};
+
+	enum PrecisionKinds {
+		DOUBLE_PRECISION,
+		SINGLE_PRECISION
 	};
 
 	enum FromDistanceKinds {
@@ -25,12 +35,24 @@ namespace Rclusterpp {
 		FromData
 	};
 
+	enum NeighborCacheKinds {
+		CachedNeighbors
+	};
+
+	enum ParallelChainKinds {
+		ParallelChains
+	};
+
 	// Forward declarations of internal data structures that can
 	// be converted to R objects via Rcpp wrap functions
 
 	class Hclust;
+	class NativeHclust;
 
 	template<class T>
+	class HeapClusterStorage;
+
+	template<class T, class Storage=HeapClusterStorage<T> >
 	class ClusterVector;
 }
 
@@ -42,12 +64,16 @@ namespace Eigen {
 	typedef Eigen::Map<NumericMatrix>                                              MapNumericMatrix;
 	typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> RowMajorNumericMatrix;
 	typedef Eigen::TriangularView<NumericMatrix,Eigen::StrictlyLower>              StrictlyLowerNumericMatrix;
+	typedef Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>  RowMajorFloatMatrix;
 
 }
 
+#ifndef RCLUSTERPP_NATIVE
+
 namespace Rcpp {
 	
 	template <> Eigen::RowMajorNumericMatrix as(SEXP x); 
+	template <> Eigen::RowMajorFloatMatrix as(SEXP x); 
 	
 	// These functions map indices provided by R-bindings to linkage and distance
 	// methods. The relationship between the index and the method needs to be kept'
@@ -55,10 +81,14 @@ namespace Rcpp {
 	
 	template <> Rclusterpp::LinkageKinds as(SEXP x);	
 	template <> Rclusterpp::DistanceKinds as(SEXP x);
+	template <> Rclusterpp::PrecisionKinds as(SEXP x);
 
 	template <> SEXP wrap( const Rclusterpp::Hclust& );
-	template <typename T> SEXP wrap( const Rclusterpp::ClusterVector<T>& ) ;
+	template <> SEXP wrap( const Rclusterpp::NativeHclust& );
+	template <typename T, typename S> SEXP wrap( const Rclusterpp::ClusterVector<T,S>& ) ;
 }
 
+#endif // RCLUSTERPP_NATIVE
+
 
 #endif
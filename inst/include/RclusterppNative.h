@@ -0,0 +1,35 @@
+#ifndef RCLUSTERPPNATIVE_H
+#define RCLUSTERPPNATIVE_H
+
+// The clustering engines for use without R (or Rcpp), e.g., in native benchmarks. Only Eigen is required. The
+// R-specific Hclust results and Rcpp conversions are omitted, use NativeHclust for the results instead.
+
+#ifndef RCLUSTERPP_NATIVE
+#define RCLUSTERPP_NATIVE
+#endif
+
+#include <cstddef>
+#include <cmath>
+#include <vector>
+#include <stdexcept>
+#include <functional>
+
+#define EIGEN_PERMANENTLY_DISABLE_STUPID_WARNINGS
+
+#define EIGEN_MATRIXBASE_PLUGIN <RclusterppEigenMatrixPlugin.h>
+#define EIGEN_ARRAYBASE_PLUGIN <RclusterppEigenArrayPlugin.h>
+#include <Eigen/Dense>
+#include <RclusterppForward.h>
+
+#include <RclusterppEigenSugar.h>
+
+#include <Rclusterpp/cluster.h>
+#include <Rclusterpp/condensed.h>
+#include <Rclusterpp/algorithm.h>
+#include <Rclusterpp/method.h>
+#include <Rclusterpp/kdtree.h>
+#include <Rclusterpp/aggregate.h>
+#include <Rclusterpp/batch.h>
+#include <Rclusterpp/hclust.h>
+
+#endif
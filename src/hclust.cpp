@@ -10,11 +10,13 @@
 RcppExport SEXP linkage_kinds() {
 BEGIN_RCPP
 	// This ordering matches the 'case' statement above in the 'as' function 
-	Rcpp::CharacterVector lk(4);
+	Rcpp::CharacterVector lk(6);
 	lk[0] = "ward";
 	lk[1] = "average";
 	lk[2] = "single";
 	lk[3] = "complete";
+	lk[4] = "centroid";
+	lk[5] = "median";
 	return Rcpp::wrap(lk);
 END_RCPP
 }
@@ -22,11 +24,14 @@ END_RCPP
 RcppExport SEXP distance_kinds() {
 BEGIN_RCPP
 	// This ordering matches the 'case' statement above in the 'as' function 
-	Rcpp::CharacterVector lk(4);
+	Rcpp::CharacterVector lk(7);
 	lk[0] = "euclidean";
 	lk[1] = "manhattan";
 	lk[2] = "maximum";
 	lk[3] = "minkowski";
+	lk[4] = "sqeuclidean";
+	lk[5] = "cosine";
+	lk[6] = "pearson";
 	return Rcpp::wrap(lk);
 END_RCPP
 }
@@ -53,117 +58,595 @@ END_RCPP
 }
 
 
-RcppExport SEXP hclust_from_data(SEXP data, SEXP link, SEXP dist, SEXP minkowski) {
-BEGIN_RCPP
-	using namespace Rcpp;
-	using namespace Rclusterpp;
+namespace {
 
-	Eigen::RowMajorNumericMatrix data_e(as<Eigen::RowMajorNumericMatrix>(data));
+	// Reducible linkages are clustered with a single (cached) nearest neighbor chain or, if requested by the
+	// context, with many chains grown in parallel
 
-	LinkageKinds  lk = as<LinkageKinds>(link);
-	DistanceKinds dk = as<DistanceKinds>(dist);
+	template<class ClusteringMethod, class ClusterVector>
+	void cluster_via_chains(ClusteringMethod method, ClusterVector& clusters, const Rclusterpp::ExecutionContext& context) {
+		if (context.parallel_chains())
+			Rclusterpp::cluster_via_rnn( method, clusters, Rclusterpp::ParallelChains, context );
+		else
+			Rclusterpp::cluster_via_rnn( method, clusters, Rclusterpp::CachedNeighbors, 8, context );
+	}
 
-	switch (lk) {
-		default: 
-      throw std::invalid_argument("Linkage or distance method not yet supported");
-		case Rclusterpp::WARD: {
-			typedef NumericCluster::center cluster_type;
+	// Linkages computed from pairwise distances between rows of the (row-major) data. The distancer
+	// is selected before clustering so that the distance computations can be inlined.
+
+	template<class Matrix, class Distancer, class Result>
+	void cluster_from_rows(const Matrix& data_e, Rclusterpp::LinkageKinds lk, const Distancer& distancer, const std::vector<double>& weights, Result& result, const Rclusterpp::ExecutionContext& context) {
+		using namespace Rclusterpp;
+		
+		typedef ClusterTypes<typename Matrix::Scalar> cluster_types;
+
+		switch (lk) {
+			default: 
+				throw std::invalid_argument("Linkage or distance method not yet supported");
+			case Rclusterpp::AVERAGE: {
+				typedef typename cluster_types::obs cluster_type;
+				
+				ClusterVector<cluster_type, ArenaClusterStorage<cluster_type> > clusters(data_e.rows());
+				init_clusters_from_rows(data_e, clusters);
+				init_weights(weights, clusters);
+
+				cluster_via_chains( average_link<cluster_type>( distancer ), clusters, context );
+
+				populate_Rhclust(clusters, result);
+				return;
+			}
+			case Rclusterpp::SINGLE: {
+				typedef typename cluster_types::plain cluster_type;
+
+				ClusterVector<cluster_type, ArenaClusterStorage<cluster_type> > clusters(data_e.rows());
+				init_clusters_from_rows(data_e, clusters);
+				init_weights(weights, clusters);
+
+				cluster_via_mst( distancer, clusters, context );
+
+				populate_Rhclust(clusters, result);
+				return;
+			}
+			case Rclusterpp::COMPLETE: {
+				typedef typename cluster_types::obs cluster_type;
+
+				ClusterVector<cluster_type, ArenaClusterStorage<cluster_type> > clusters(data_e.rows());
+				init_clusters_from_rows(data_e, clusters);
+				init_weights(weights, clusters);
+
+				cluster_via_chains( complete_link<cluster_type>( distancer ), clusters, context );
+
+				populate_Rhclust(clusters, result);
+				return;
+			}
+		}
+	}
+
+	// Select the distancer for the (row-major) data once, and invoke action with that distancer, so that the
+	// distance computations can be inlined. Euclidean distances are computed in blocks with matrix products. For
+	// cosine and Pearson distances, the data is normalized in place up front so that each distance is an inner
+	// product, and so data_e must be the caller's private working copy of the data.
+
+	template<class Matrix, class Action>
+	void with_distancer(Matrix& data_e, Rclusterpp::DistanceKinds dk, double minkowski, const Action& action) {
+		using namespace Rclusterpp;
+
+		typedef typename Matrix::Scalar value_type;
+
+		switch (dk) {
+			default: 
+				throw std::invalid_argument("Linkage or distance method not yet supported");
+			case Rclusterpp::EUCLIDEAN:
+				action(stored_data_blocks<false>(data_e));
+				break;
+			case Rclusterpp::MANHATTAN:
+				action(stored_data_rows(data_e, Methods::ManhattanDistance<value_type>()));
+				break;
+			case Rclusterpp::MAXIMUM:
+				action(stored_data_rows(data_e, Methods::MaximumDistance<value_type>()));
+				break;
+			case Rclusterpp::MINKOWSKI:
+				action(stored_data_rows(data_e, Methods::MinkowskiDistance<value_type>(minkowski)));
+				break;
+			case Rclusterpp::SQEUCLIDEAN:
+				action(stored_data_blocks<true>(data_e));
+				break;
+			case Rclusterpp::COSINE:
+			case Rclusterpp::PEARSON:
+				Methods::normalize_rows(data_e, dk == Rclusterpp::PEARSON);
+				action(stored_normalized_blocks(data_e));
+				break;
+		}
+	}
+
+	template<class Matrix, class Result>
+	struct ClusterFromRows {
+		const Matrix&                       data_e;
+		Rclusterpp::LinkageKinds            lk;
+		const std::vector<double>&          weights;
+		Result&                             result;
+		const Rclusterpp::ExecutionContext& context;
+
+		template<class Distancer>
+		void operator()(const Distancer& distancer) const { cluster_from_rows(data_e, lk, distancer, weights, result, context); }
+	};
+
+	// Clustering is instantiated for both double and single precision data, distances and centers. The
+	// input matrix is typically a (column-major) view of R's memory, and is not modified. 
+
+	template<class Value, class Matrix, class Result>
+	void cluster_from_data(
+		const Matrix& data_m, Rclusterpp::LinkageKinds lk, Rclusterpp::DistanceKinds dk, double minkowski, const std::vector<double>& weights, 
+		Result& result, const Rclusterpp::ExecutionContext& context
+	) {
+		using namespace Rclusterpp;
+		
+		typedef Value                                                                  value_type;
+		typedef Eigen::Matrix<value_type, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> rows_type;
+
+		if (lk == Rclusterpp::WARD || lk == Rclusterpp::CENTROID || lk == Rclusterpp::MEDIAN) {
+			typedef typename ClusterTypes<value_type>::plain cluster_type;
 
-			ClusterVector<cluster_type> clusters(data_e.rows());	
-			init_clusters_from_rows(data_e, clusters);
+			ClusterVector<cluster_type, ArenaClusterStorage<cluster_type> > clusters(data_m.rows());	
+			init_clusters(data_m, clusters);
+			init_weights(weights, clusters);
+			
+			// Centers are maintained outside of the clusters and initialized directly from the input
+			Methods::StoredCenters<value_type> centers(data_m);  
 	
-			cluster_via_rnn( wards_link<cluster_type>(), clusters );
+			if (lk == Rclusterpp::CENTROID) {
+				cluster_via_heap( centroid_link<cluster_type>(centers), clusters, context );
+			} else if (lk == Rclusterpp::MEDIAN) {
+				cluster_via_heap( median_link<cluster_type>(centers), clusters, context );
+			} else if (data_m.cols() <= 4 && !context.parallel_chains()) {
+				// In low dimensions a spatial index prunes most of the (parallel) nearest neighbor scan
+				Methods::WardsKDTree<value_type> index(centers, clusters);
+				cluster_via_rnn( wards_link<cluster_type>(centers), clusters, CachedNeighbors, 8, index, context );
+			} else {
+				cluster_via_chains( wards_link<cluster_type>(centers), clusters, context );
+			}
 			
-			return wrap(clusters);	
+			populate_Rhclust(clusters, result);
+			return;
 		}
-		case Rclusterpp::AVERAGE: {
-			typedef NumericCluster::obs cluster_type;
+		
+		if (lk == Rclusterpp::AVERAGE && dk == Rclusterpp::SQEUCLIDEAN) {
+			// Average squared Euclidean distances are computed in O(m) from the cluster moments
+			typedef typename ClusterTypes<value_type>::plain cluster_type;
+
+			ClusterVector<cluster_type, ArenaClusterStorage<cluster_type> > clusters(data_m.rows());	
+			init_clusters(data_m, clusters);
+			init_weights(weights, clusters);
 
-			ClusterVector<cluster_type> clusters(data_e.rows());
-			init_clusters_from_rows(data_e, clusters);
+			// Moments are maintained outside of the clusters and initialized directly from the input
+			Methods::StoredMoments<value_type> moments(data_m);
 
-			cluster_via_rnn( average_link<cluster_type>( stored_data_rows(data_e, dk, as<double>(minkowski)) ), clusters );
+			cluster_via_chains( average_sqeuclidean_link<cluster_type>(moments), clusters, context );
 
-			return wrap(clusters);
+			populate_Rhclust(clusters, result);
+			return;
 		}
-		case Rclusterpp::SINGLE: {
-			typedef NumericCluster::plain cluster_type;
 
-			ClusterVector<cluster_type> clusters(data_e.rows());
-			init_clusters_from_rows(data_e, clusters);
+		rows_type data_e(data_m.template cast<value_type>());  // Distances computed between arbitrary pairs of rows
+		RCLUSTERPP_STATS_MEMORY(data_memory)
+		RCLUSTERPP_STATS_ALLOCATED(data_memory, data_e.size() * sizeof(value_type));
+
+		ClusterFromRows<rows_type, Result> action = { data_e, lk, weights, result, context };
+		with_distancer(data_e, dk, minkowski, action);
+	}
 
-			cluster_via_slink( stored_data_rows(data_e, dk, as<double>(minkowski)), clusters );
+	template<class Matrix, class Result>
+	void cluster_from_condensed(Matrix& data_c, Rclusterpp::LinkageKinds lk, const std::vector<double>& weights, Result& result, const Rclusterpp::ExecutionContext& context) {
+		using namespace Rclusterpp;
 
-			return wrap(clusters);
+		typedef typename ClusterTypes<typename Matrix::Scalar>::plain cluster_type;
+
+		ClusterVector<cluster_type, ArenaClusterStorage<cluster_type> > clusters(data_c.rows());
+		init_clusters(data_c, clusters);
+		init_weights(weights, clusters);
+
+		switch (lk) {
+		default: 
+			throw std::invalid_argument("Linkage or distance method not yet supported");
+		case Rclusterpp::AVERAGE:
+			cluster_via_chains( average_link<cluster_type>(data_c, FromDistance), clusters, context );
+			break;
+		case Rclusterpp::SINGLE:
+			cluster_via_chains( single_link<cluster_type>(data_c, FromDistance), clusters, context );
+			break;
+		case Rclusterpp::COMPLETE:
+			cluster_via_chains( complete_link<cluster_type>(data_c, FromDistance), clusters, context );
+			break;
+		case Rclusterpp::CENTROID:
+			cluster_via_heap( centroid_link<cluster_type>(data_c, FromDistance), clusters, context );
+			break;
+		case Rclusterpp::MEDIAN:
+			cluster_via_heap( median_link<cluster_type>(data_c, FromDistance), clusters, context );
+			break;
 		}
-		case Rclusterpp::COMPLETE: {
-			typedef NumericCluster::obs cluster_type;
 
-			ClusterVector<cluster_type> clusters(data_e.rows());
-			init_clusters_from_rows(data_e, clusters);
+		populate_Rhclust(clusters, result);
+	}
+
+	// Lance-Williams updates modify the distances in place, so we operate on a private copy of the packed
+	// distance vector (instead of expanding it into a dense N x N matrix). If that copy would exceed the memory 
+	// budget (in bytes), it is stored in a memory-mapped file in the scratch directory instead.
+
+	template<class Value, class Fill, class Result>
+	void cluster_from_stored(
+		int N, Rclusterpp::LinkageKinds lk, const std::vector<double>& weights, const std::string& scratch, double budget, const Fill& fill, 
+		Result& result, const Rclusterpp::ExecutionContext& context
+	) {
+		using namespace Rclusterpp;
+
+		if (CondensedMatrix<Value>::packed_size(N) * sizeof(Value) <= budget) {
+			CondensedMatrix<Value> data_c(N);
+			fill(data_c);
+			cluster_from_condensed(data_c, lk, weights, result, context);
+		} else {
+			typedef TiledCondensedMatrix<Value> matrix_type;
+			
+			Util::MappedFile file(scratch, matrix_type::packed_size(N) * sizeof(Value));
+			matrix_type data_c(N, static_cast<Value*>(file.data()));
+			fill(data_c);
+			cluster_from_condensed(data_c, lk, weights, result, context);
+		}
+	}
+
+	// The stored distances are either copied from an R dist vector, or computed directly from the data
+
+	struct PackedFill {
+		const double* data;
+
+		template<class Matrix>
+		void operator()(Matrix& m) const { Rclusterpp::copy_packed(data, m); }
+	};
+
+	template<class Distancer>
+	struct DistanceFill {
+		Distancer                           distancer;
+		size_t                              tile;
+		const Rclusterpp::ExecutionContext& context;
 
-			cluster_via_rnn( complete_link<cluster_type>( stored_data_rows(data_e, dk, as<double>(minkowski)) ), clusters );
+		template<class Matrix>
+		void operator()(Matrix& m) const { Rclusterpp::condensed_distances(distancer, m, tile, context); }
+	};
 
-			return wrap(clusters);
+	template<class Value, class Result>
+	void cluster_from_distance(
+		SEXP data, int N, Rclusterpp::LinkageKinds lk, const std::vector<double>& weights, const std::string& scratch, double budget, 
+		Result& result, const Rclusterpp::ExecutionContext& context
+	) {
+		using namespace Rclusterpp;
+
+		if ((size_t)XLENGTH(data) != CondensedMatrix<Value>::packed_size(N))
+			throw std::invalid_argument("Distance vector inconsistent with size");
+
+		PackedFill fill = { REAL(data) };
+		cluster_from_stored<Value>(N, lk, weights, scratch, budget, fill, result, context);
+	}
+
+	template<class Value, class Result>
+	struct ClusterFromStored {
+		int                                 N;
+		Rclusterpp::LinkageKinds            lk;
+		const std::vector<double>&          weights;
+		const std::string&                  scratch;
+		double                              budget;
+		size_t                              tile;
+		Result&                             result;
+		const Rclusterpp::ExecutionContext& context;
+
+		template<class Distancer>
+		void operator()(const Distancer& distancer) const { 
+			DistanceFill<Distancer> fill = { distancer, tile, context };
+			cluster_from_stored<Value>(N, lk, weights, scratch, budget, fill, result, context); 
+		}
+	};
+
+	// Stored distance (Lance-Williams) clustering with the distances computed from the data in parallel, in 
+	// the given precision, without an intermediate R dist vector
+	template<class Value, class Matrix, class Result>
+	void cluster_from_data_distance(
+		const Matrix& data_m, Rclusterpp::LinkageKinds lk, Rclusterpp::DistanceKinds dk, double minkowski, const std::vector<double>& weights, 
+		const std::string& scratch, double budget, Result& result, const Rclusterpp::ExecutionContext& context
+	) {
+		using namespace Rclusterpp;
+		
+		typedef Eigen::Matrix<Value, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> rows_type;
+		
+		rows_type data_e(data_m.template cast<Value>());
+		RCLUSTERPP_STATS_MEMORY(data_memory)
+		RCLUSTERPP_STATS_ALLOCATED(data_memory, data_e.size() * sizeof(Value));
+		
+		ClusterFromStored<Value, Result> action = { 
+			(int)data_e.rows(), lk, weights, scratch, budget, distance_tile_size(data_e.cols(), sizeof(Value)), result, context 
+		};
+		with_distancer(data_e, dk, minkowski, action);
+	}
+
+	// Distances between the rows of the data written directly into an R dist vector 
+	struct PackedDistance {
+		Rcpp::NumericVector&                result;
+		int                                 N;
+		size_t                              tile;
+		const Rclusterpp::ExecutionContext& context;
+
+		template<class Distancer>
+		void operator()(const Distancer& distancer) const {
+			Rclusterpp::CondensedMatrix<double> data_c(N, REAL(result));
+			Rclusterpp::condensed_distances(distancer, data_c, tile, context);
+		}
+	};
+
+	// Batches of independent data sets are clustered concurrently (see run_batch) into native results, since R
+	// can't be used by the concurrent clusterings. Data sets with at least batch_parallel_size observations
+	// are instead clustered one at a time with all of the threads.
+
+	const size_t batch_parallel_size = 4096;
+
+	template<class Value>
+	struct ClusterBatch {
+		const std::vector<Eigen::MapNumericMatrix>& data_m;
+		Rclusterpp::LinkageKinds                    lk;
+		Rclusterpp::DistanceKinds                   dk;
+		double                                      minkowski;
+		std::vector<Rclusterpp::NativeHclust>&      results;
+
+		void operator()(size_t i, const Rclusterpp::ExecutionContext& context) const {
+			cluster_from_data<Value>(data_m[i], lk, dk, minkowski, std::vector<double>(), results[i], context);
+		}
+	};
+
+	// Pre-aggregation of (large) data into micro-clusters, returned in the form of an R kmeans object
+
+	template<class Matrix, class Distance>
+	SEXP aggregate_rows(const Matrix& data_m, Distance distance, size_t k, size_t batch, size_t iterations, unsigned int seed, const Rclusterpp::ExecutionContext& context) {
+		using namespace Rclusterpp;
+		
+		MicroClusters<double> micro;
+		aggregate_via_kmeans(data_m, distance, k, batch, iterations, seed, micro, context);
+
+		Rcpp::IntegerVector cluster(micro.assignment.size());
+		for (size_t i=0; i<micro.assignment.size(); i++) {
+			cluster[i] = micro.assignment[i] + 1;  // R is 1-indexed
 		}
 
+		using Rcpp::_;
+		return Rcpp::List::create( 
+			_["cluster"] = cluster, 
+			_["centers"] = Rcpp::wrap(Eigen::NumericMatrix(micro.centers)), 
+			_["size"]    = Rcpp::wrap(micro.weights) 
+		);
+	}
+
+	// Optional weights (R's 'members') for the initial clusters, empty if unweighted
+	std::vector<double> cluster_weights(SEXP members, int N) {
+		std::vector<double> weights;
+		if (!Rf_isNull(members)) {
+			weights = Rcpp::as<std::vector<double> >(members);
+			if (weights.size() != (size_t)N)
+				throw std::invalid_argument("Members inconsistent with number of observations");
+		}
+		return weights;
+	}
+
+	// Clustering results for R, with the statistics collected during the clustering (see Rclusterpp/stats.h), if
+	// enabled, as the "stats" attribute
+	SEXP wrap_hclust(const Rclusterpp::Hclust& hclust) {
+		Rcpp::List result(Rcpp::wrap(hclust));
+#ifdef RCLUSTERPP_STATS
+		std::vector<double>   stats = Rclusterpp::Stats::collect();
+		Rcpp::NumericVector   values(stats.begin(), stats.end());
+		Rcpp::CharacterVector names(stats.size());
+		for (size_t i=0; i<stats.size(); i++)
+			names[i] = Rclusterpp::Stats::name(i);
+		values.attr("names") = names;
+		result.attr("stats") = values;
+#endif
+		return result;
 	}
+
+}
+
+RcppExport SEXP hclust_from_data(SEXP data, SEXP link, SEXP dist, SEXP minkowski, SEXP precision, SEXP members, SEXP threads, SEXP chains) {
+BEGIN_RCPP
+	using namespace Rcpp;
+	using namespace Rclusterpp;
+
+	LinkageKinds  lk = as<LinkageKinds>(link);
+	DistanceKinds dk = as<DistanceKinds>(dist);
+
+	Eigen::MapNumericMatrix data_m(as<Eigen::MapNumericMatrix>(data));  // No copy of R's memory
+	
+	std::vector<double> weights = cluster_weights(members, data_m.rows());
+
+	ExecutionContext context(as<int>(threads), as<bool>(chains));
+	Hclust           hclust(data_m.rows());
+
+	RCLUSTERPP_STATS_RESET();
+
+	switch (as<PrecisionKinds>(precision)) {
+		default:
+		case Rclusterpp::DOUBLE_PRECISION:
+			cluster_from_data<double>(data_m, lk, dk, as<double>(minkowski), weights, hclust, context);
+			break;
+		case Rclusterpp::SINGLE_PRECISION:
+			cluster_from_data<float>(data_m, lk, dk, as<double>(minkowski), weights, hclust, context);
+			break;
+	}
+	return wrap_hclust(hclust);
 	 
 END_RCPP
 }
 
-namespace {
+RcppExport SEXP hclust_batch_from_data(SEXP data, SEXP link, SEXP dist, SEXP minkowski, SEXP precision, SEXP threads) {
+BEGIN_RCPP
+	using namespace Rcpp;
+	using namespace Rclusterpp;
+
+	LinkageKinds  lk = as<LinkageKinds>(link);
+	DistanceKinds dk = as<DistanceKinds>(dist);
 
-	template<class Matrix>
-	void populate_strictly_lower(Matrix& m, SEXP data) {
-		ssize_t N = m.rows();
+	List datasets(data);
+	
+	std::vector<Eigen::MapNumericMatrix> data_m;  // No copies of R's memory
+	std::vector<NativeHclust>            results;
+	std::vector<size_t>                  sizes;
+	for (size_t i=0; i<datasets.size(); i++) {
+		data_m.push_back(as<Eigen::MapNumericMatrix>(datasets[i]));
+		if (data_m.back().rows() < 2)
+			throw std::invalid_argument("Each data set must have at least two observations");
+		results.push_back(NativeHclust(data_m.back().rows()));
+		sizes.push_back(data_m.back().rows());
+	}
 
-		const int RTYPE = ::Rcpp::traits::r_sexptype_traits<Eigen::NumericMatrix::Scalar>::rtype; 
-		if (TYPEOF(data) != RTYPE)
-			throw std::invalid_argument("Wrong R type for mapped vector");
-		
-		double *d_start = REAL(data);
+	ExecutionContext context(as<int>(threads));
 
-		for (ssize_t c=0; c<N-1; c++) {
-			m.block(c+1 /* starting row */, c, N-(c+1) /* numer of rows*/, 1) = Eigen::Map<Eigen::NumericMatrix>(d_start,N-(c+1),1);
-			d_start += N-(c+1);
+	switch (as<PrecisionKinds>(precision)) {
+		default:
+		case Rclusterpp::DOUBLE_PRECISION: {
+			ClusterBatch<double> job = { data_m, lk, dk, as<double>(minkowski), results };
+			run_batch(sizes, batch_parallel_size, job, context);
+			break;
 		}
+		case Rclusterpp::SINGLE_PRECISION: {
+			ClusterBatch<float> job = { data_m, lk, dk, as<double>(minkowski), results };
+			run_batch(sizes, batch_parallel_size, job, context);
+			break;
+		}
+	}
+
+	List hclusts(results.size());
+	for (size_t i=0; i<results.size(); i++) {
+		hclusts[i] = wrap(results[i]);
+	}
+	return hclusts;
+END_RCPP
+}
+
+RcppExport SEXP hclust_from_data_distance(SEXP data, SEXP link, SEXP dist, SEXP minkowski, SEXP members, SEXP precision, SEXP scratch, SEXP memory, SEXP threads, SEXP chains) {
+BEGIN_RCPP
+	using namespace Rcpp;
+	using namespace Rclusterpp;
+
+	LinkageKinds  lk = as<LinkageKinds>(link);
+	DistanceKinds dk = as<DistanceKinds>(dist);
+
+	Eigen::MapNumericMatrix data_m(as<Eigen::MapNumericMatrix>(data));  // No copy of R's memory
+	
+	std::vector<double> weights = cluster_weights(members, data_m.rows());
+
+	std::string scratch_dir = as<std::string>(scratch);
+	double      budget      = as<double>(memory);
+
+	ExecutionContext context(as<int>(threads), as<bool>(chains));
+	Hclust           hclust(data_m.rows());
+
+	RCLUSTERPP_STATS_RESET();
+
+	switch (as<PrecisionKinds>(precision)) {
+		default:
+		case Rclusterpp::DOUBLE_PRECISION:
+			cluster_from_data_distance<double>(data_m, lk, dk, as<double>(minkowski), weights, scratch_dir, budget, hclust, context);
+			break;
+		case Rclusterpp::SINGLE_PRECISION:
+			cluster_from_data_distance<float>(data_m, lk, dk, as<double>(minkowski), weights, scratch_dir, budget, hclust, context);
+			break;
 	}
+	return wrap_hclust(hclust);
+END_RCPP
+}
+
+RcppExport SEXP dist_from_data(SEXP data, SEXP dist, SEXP minkowski, SEXP threads) {
+BEGIN_RCPP
+	using namespace Rcpp;
+	using namespace Rclusterpp;
+
+	DistanceKinds dk = as<DistanceKinds>(dist);
+
+	Eigen::MapNumericMatrix    data_m(as<Eigen::MapNumericMatrix>(data));  // No copy of R's memory
+	Eigen::RowMajorNumericMatrix data_e(data_m);                          // Distances computed between rows
 	
+	NumericVector result(CondensedMatrix<double>::packed_size(data_e.rows()));
+
+	ExecutionContext context(as<int>(threads));
+
+	PackedDistance action = { result, (int)data_e.rows(), distance_tile_size(data_e.cols(), sizeof(double)), context };
+	with_distancer(data_e, dk, as<double>(minkowski), action);
+	return result;
+END_RCPP
 }
 
-RcppExport SEXP hclust_from_distance(SEXP data, SEXP size, SEXP link) {
+RcppExport SEXP aggregate_from_data(SEXP data, SEXP centers, SEXP dist, SEXP minkowski, SEXP batch, SEXP iterations, SEXP seed, SEXP threads) {
 BEGIN_RCPP
 	using namespace Rcpp;
 	using namespace Rclusterpp;
 
-	int N = as<int>(size);	
-	Eigen::NumericMatrix data_e(N, N);
+	DistanceKinds dk = as<DistanceKinds>(dist);
+
+	Eigen::MapNumericMatrix data_m(as<Eigen::MapNumericMatrix>(data));  // No copy of R's memory
 	
-	populate_strictly_lower(data_e, data);  // Populate strictly lower distance matrix from packed vector
-	Eigen::StrictlyLowerNumericMatrix data_t = data_e.triangularView<Eigen::StrictlyLower>(); 
-			
-	typedef NumericCluster::plain cluster_type;
+	size_t       k  = as<int>(centers), b = as<int>(batch), it = as<int>(iterations);
+	unsigned int s  = as<unsigned int>(seed);
+	if (k < 1 || b < 1)
+		throw std::invalid_argument("Number of centers and batch size must be positive");
 
-	ClusterVector<cluster_type> clusters(data_t.rows());
-	init_clusters(data_t, clusters);
+	ExecutionContext context(as<int>(threads));
 
-	LinkageKinds  lk = as<LinkageKinds>(link);
-	switch (lk) {
-	default: 
-		throw std::invalid_argument("Linkage or distance method not yet supported");
-	case Rclusterpp::AVERAGE:
-		cluster_via_rnn( average_link<cluster_type>(data_t, FromDistance), clusters );
-		break;
-	case Rclusterpp::SINGLE:
-		cluster_via_rnn( single_link<cluster_type>(data_t, FromDistance),  clusters );
-		break;
-	case Rclusterpp::COMPLETE:
-		cluster_via_rnn( complete_link<cluster_type>(data_t, FromDistance), clusters );
-		break;
-	}
-
-	return wrap(clusters);
+	switch (dk) {
+		default: 
+			throw std::invalid_argument("Distance method not yet supported");
+		case Rclusterpp::EUCLIDEAN:
+			return aggregate_rows(data_m, Methods::EuclideanDistance<double>(), k, b, it, s, context);
+		case Rclusterpp::MANHATTAN:
+			return aggregate_rows(data_m, Methods::ManhattanDistance<double>(), k, b, it, s, context);
+		case Rclusterpp::MAXIMUM:
+			return aggregate_rows(data_m, Methods::MaximumDistance<double>(), k, b, it, s, context);
+		case Rclusterpp::MINKOWSKI:
+			return aggregate_rows(data_m, Methods::MinkowskiDistance<double>(as<double>(minkowski)), k, b, it, s, context);
+		case Rclusterpp::SQEUCLIDEAN:
+			return aggregate_rows(data_m, Methods::SquaredEuclideanDistance<double>(), k, b, it, s, context);
+		case Rclusterpp::COSINE:
+			return aggregate_rows(data_m, Methods::CosineDistance<double>(), k, b, it, s, context);
+		case Rclusterpp::PEARSON:
+			return aggregate_rows(data_m, Methods::PearsonDistance<double>(), k, b, it, s, context);
+	}
+END_RCPP
+}
+
+RcppExport SEXP hclust_from_distance(SEXP data, SEXP size, SEXP link, SEXP members, SEXP precision, SEXP scratch, SEXP memory, SEXP threads, SEXP chains) {
+BEGIN_RCPP
+	using namespace Rcpp;
+	using namespace Rclusterpp;
+
+	const int RTYPE = ::Rcpp::traits::r_sexptype_traits<double>::rtype; 
+	if (TYPEOF(data) != RTYPE)
+		throw std::invalid_argument("Wrong R type for distance vector");
+
+	int          N  = as<int>(size);	
+	LinkageKinds lk = as<LinkageKinds>(link);
+	
+	std::vector<double> weights = cluster_weights(members, N);
+
+	std::string scratch_dir = as<std::string>(scratch);
+	double      budget      = as<double>(memory);
+
+	ExecutionContext context(as<int>(threads), as<bool>(chains));
+	Hclust           hclust(N);
+
+	RCLUSTERPP_STATS_RESET();
+	
+	switch (as<PrecisionKinds>(precision)) {
+		default:
+		case Rclusterpp::DOUBLE_PRECISION:
+			cluster_from_distance<double>(data, N, lk, weights, scratch_dir, budget, hclust, context);
+			break;
+		case Rclusterpp::SINGLE_PRECISION:
+			cluster_from_distance<float>(data, N, lk, weights, scratch_dir, budget, hclust, context);
+			break;
+	}
+	return wrap_hclust(hclust);
 END_RCPP
 }
 
@@ -172,8 +655,12 @@ static const R_CallMethodDef CallEntries[] = {
     {"distance_kinds", (DL_FUNC) &distance_kinds, 0},
     {"rclusterpp_get_num_procs", (DL_FUNC) &rclusterpp_get_num_procs, 0},
     {"rclusterpp_set_num_threads", (DL_FUNC) &rclusterpp_set_num_threads, 2},
-    {"hclust_from_data", (DL_FUNC) &hclust_from_data, 5},
-    {"hclust_from_distance", (DL_FUNC) &hclust_from_distance, 4},
+    {"hclust_from_data", (DL_FUNC) &hclust_from_data, 9},
+    {"hclust_batch_from_data", (DL_FUNC) &hclust_batch_from_data, 7},
+    {"hclust_from_distance", (DL_FUNC) &hclust_from_distance, 10},
+    {"hclust_from_data_distance", (DL_FUNC) &hclust_from_data_distance, 11},
+    {"dist_from_data", (DL_FUNC) &dist_from_data, 5},
+    {"aggregate_from_data", (DL_FUNC) &aggregate_from_data, 9},
     {NULL, NULL, 0}
 };
 